@@ -0,0 +1,940 @@
+/**********************************************************************/
+/*                                                                    */
+/* Program Name: bench - Measure the driver against a simulated disk  */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This program replays scripted file system workloads through the    */
+/* real driver linked against the simulated disk, once for every      */
+/* scheduling policy, and prints the throughput, latency, and head    */
+/* travel of each run.  Every run is made in its own child process    */
+/* so each one starts the driver from scratch.                        */
+/*                                                                    */
+/* Build it with the driver's own main left out:                      */
+/*                                                                    */
+/*   cc -pthread -o bench -DNO_DRIVER_MAIN bench.c disk_sim.c         */
+/*      driver.c pending.c schedule.c cache.c stats.c ring.c power.c  */
+/*      trace.c                                                       */
+/*                                                                    */
+/* and run it as bench [-c requests] [-w workload] [-s policy]        */
+/* [-f seek_error_interval] [-n pool_requests] [-m merge_blocks]      */
+/* [-b batch_size] [-l 0|1] [-d drives] [-g geometry]                 */
+/* [-k cache_kbytes] [-r read_ahead] [-t flush_time]                  */
+/* [-i spin_down_time] [-q 0|1] [-o stats_file]                       */
+/* [-x trace_file] [-y trace_file] [-p ring_producers].  Every number */
+/* must be a whole number, and -f N makes one seek in N land on the   */
+/* wrong cylinder.  With more than one drive each workload is spread  */
+/* over the drives at random and sped up so every drive sees the load */
+/* one drive would on its own.  With -o each run's driver adds its    */
+/* statistics to the file after a line naming the run's workload and  */
+/* policy.  With -q 0 the driver is told every request is an ordinary */
+/* one with no deadline, while the urgent latency and deadline misses */
+/* are still scored against the script.                               */
+/*                                                                    */
+/* With -x each run's driver traces its messages and device commands  */
+/* to the file, each run writing over the last, so it is best given   */
+/* with a single workload and policy.  With -y the workloads are      */
+/* replaced by the messages of a trace, recorded here or by the       */
+/* driver on a real disk, submitted at the times they were taken in   */
+/* on the disks the trace was recorded on, so the same arrivals can   */
+/* be run again through every policy.                                 */
+/*                                                                    */
+/* With -p no workloads are run.  Instead 1, 2, 4, and so on up to    */
+/* the given number of threads send numbered messages through the     */
+/* submission ring at once while one thread passes them back through  */
+/* the completion ring, and the message rate, the times a ring was    */
+/* full, and any message lost or out of order are printed.            */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "disk_sim.h"
+
+/**********************************************************************/
+/*                         Symbolic Constants                         */
+/**********************************************************************/
+#define DEFAULT_BENCH_REQUESTS 1000 /* Requests in each workload      */
+#define BENCH_ERR 6                 /* Benchmark run failure          */
+#define SEQUENTIAL_GROUP_TIME 2000000 /* Time between cylinders of a  */
+                                      /* sequential read              */
+#define RANDOM_ARRIVAL_TIME 250000  /* Mean time between random       */
+                                    /* requests                       */
+#define HOT_SPOT_ARRIVAL_TIME 200000 /* Mean time between hot spot    */
+                                     /* requests                      */
+#define HOT_SPOT_PERCENT 80         /* Requests that hit the hot spot */
+#define HOT_SPOT_CYLINDERS 2        /* Cylinders in the hot spot      */
+#define BURST_REQUESTS 30           /* Requests in each burst         */
+#define BURST_GAP_TIME 5000000      /* Shortest quiet time between    */
+                                    /* bursts                         */
+#define READ_PERCENT 70             /* Random requests that are reads */
+#define STREAM_READERS 2            /* Readers streaming at once      */
+#define STREAM_ARRIVAL_TIME 300000  /* Time between one reader's      */
+                                    /* reads                          */
+#define MIXED_ARRIVAL_TIME 150000   /* Time between mixed requests    */
+#define MIXED_URGENT_PERCENT 25     /* Mixed requests that are urgent */
+                                    /* reads                          */
+#define MIXED_DEADLINE_TIME 1500000 /* Time an urgent read must be    */
+                                    /* done within                    */
+#define RING_BENCH_MESSAGES 1000000 /* Messages each producer sends   */
+                                    /* through the rings              */
+#define MAX_PRODUCERS 64            /* Most ring benchmark producers  */
+
+/**********************************************************************/
+/*                         Program Structures                         */
+/**********************************************************************/
+/* A named workload and the function that scripts it                  */
+struct workload_type
+{
+    char *p_name;                    /* The workload's name            */
+    void (*p_generate)(WORKLOAD_REQUEST *p_workload, int count,
+                       DISK_MODEL *p_model, unsigned long long *p_seed);
+                                     /* Scripts the workload           */
+};
+typedef struct workload_type WORKLOAD_TYPE;
+
+/* One thread sending or checking messages in the ring benchmark      */
+struct ring_thread
+{
+    pthread_t thread;                /* The thread running             */
+    int thread_number,               /* The producer's number, from 0  */
+        producers;                   /* Producers in the run           */
+    long long full_count,            /* Times the ring was full        */
+        errors;                      /* Messages lost or out of order  */
+};
+typedef struct ring_thread RING_THREAD;
+
+/**********************************************************************/
+/*                        Function Prototypes                         */
+/**********************************************************************/
+void generate_sequential(WORKLOAD_REQUEST *p_workload, int count,
+                         DISK_MODEL *p_model, unsigned long long *p_seed);
+/* Script one reader walking the disk a cylinder at a time            */
+void generate_random(WORKLOAD_REQUEST *p_workload, int count,
+                     DISK_MODEL *p_model, unsigned long long *p_seed);
+/* Script reads and writes spread evenly over the disk                */
+void generate_hot_spot(WORKLOAD_REQUEST *p_workload, int count,
+                       DISK_MODEL *p_model, unsigned long long *p_seed);
+/* Script requests crowding a few cylinders in the middle of the disk */
+void generate_bursty(WORKLOAD_REQUEST *p_workload, int count,
+                     DISK_MODEL *p_model, unsigned long long *p_seed);
+/* Script bursts of random requests with long quiet times between     */
+void generate_stream(WORKLOAD_REQUEST *p_workload, int count,
+                     DISK_MODEL *p_model, unsigned long long *p_seed);
+/* Script readers each reading their own part of the disk a block at  */
+/* a time                                                             */
+int random_operation(unsigned long long *p_seed);
+/* Return a read or write for a random request                        */
+void generate_mixed(WORKLOAD_REQUEST *p_workload, int count,
+                    DISK_MODEL *p_model, unsigned long long *p_seed);
+/* Script urgent random reads with deadlines among a background       */
+/* writer's sequential writes                                         */
+void reset_classes(WORKLOAD_REQUEST *p_workload, int count);
+/* Script every request as an ordinary one with no deadline           */
+void spread_workload(WORKLOAD_REQUEST *p_workload, int count, int drives,
+                     unsigned long long *p_seed);
+/* Spread a workload over the drives, each at one drive's full rate   */
+WORKLOAD_REQUEST *load_trace(char *p_path, int *p_count);
+/* Read the messages of a driver trace into a workload, taking the    */
+/* disks the trace was recorded on                                    */
+void run_policies(char *p_name, DISK_MODEL *p_model,
+                  WORKLOAD_REQUEST *p_workload, int count, int only_policy,
+                  bool send_classes);
+/* Run each policy, or just the one asked for, over a workload and    */
+/* print a line for each                                              */
+bool run_benchmark(DISK_MODEL *p_model, WORKLOAD_REQUEST *p_workload,
+                   int count, bool send_classes, SIM_RESULT *p_result);
+/* Run the driver over one workload in a child process                */
+void run_ring_benchmark(int producers);
+/* Time and check messages sent by many threads at once through the   */
+/* submission ring and back through the completion ring               */
+void *produce_messages(void *p_argument);
+/* Send one producer's numbered messages into the submission ring     */
+void *reap_messages(void *p_argument);
+/* Take the replies off the completion ring and check each producer's */
+/* arrive complete and in order                                       */
+
+/**********************************************************************/
+/*                          Global Variables                          */
+/**********************************************************************/
+WORKLOAD_TYPE workload_type[] = {{"sequential", generate_sequential},
+                                 {"random", generate_random},
+                                 {"hotspot", generate_hot_spot},
+                                 {"bursty", generate_bursty},
+                                 {"stream", generate_stream},
+                                 {"mixed", generate_mixed},
+                                 {NULL, NULL}};
+                                /* The workloads, in report order     */
+
+/**********************************************************************/
+/*                           Main Function                            */
+/**********************************************************************/
+int main(int argc, char *argv[])
+{
+    DISK_MODEL model = default_disk_model; /* The simulated disk      */
+    WORKLOAD_REQUEST *p_workload;          /* The scripted requests   */
+    unsigned long long seed;               /* Workload random seed    */
+    char *p_only_workload = NULL,          /* Run just this workload  */
+        *p_replay_path = NULL;             /* Trace to replay instead */
+                                           /* of the workloads        */
+    int count = DEFAULT_BENCH_REQUESTS,    /* Requests per workload   */
+        ring_producers = 0,                /* Producers for the ring  */
+                                           /* benchmark, 0 for none   */
+        use_classes = 1,                   /* Send the workloads'     */
+                                           /* priority classes and    */
+                                           /* deadlines, 1 for yes    */
+        only_policy = -1,                  /* Run just this policy    */
+        option,                            /* The option letter       */
+        type;                              /* Count the workloads     */
+
+    while ((option = getopt(argc, argv,
+                            "c:w:s:f:n:m:b:l:d:g:k:r:t:i:q:o:x:y:p:")) != -1)
+    {
+        switch (option)
+        {
+        case 'c':
+            count = parse_number(optarg, INT_MAX);
+            break;
+        case 'w':
+            p_only_workload = optarg;
+            break;
+        case 's':
+            if ((only_policy = find_policy(optarg)) < 0)
+                count = 0;
+            break;
+        case 'f':
+            model.seek_error_interval = parse_number(optarg, INT_MAX);
+            break;
+        case 'n':
+            driver_options.pool_requests = parse_number(optarg, INT_MAX);
+            break;
+        case 'm':
+            driver_options.merge_blocks = parse_number(optarg, INT_MAX);
+            break;
+        case 'b':
+            driver_options.batch_size = parse_number(optarg, INT_MAX);
+            break;
+        case 'l':
+            driver_options.lookahead = parse_number(optarg, INT_MAX);
+            break;
+        case 'd':
+            driver_options.devices = parse_number(optarg, INT_MAX);
+            break;
+        case 'g':
+            if (!parse_geometry(optarg, &disk_geometry))
+                count = 0;
+            break;
+        case 'k':
+            driver_options.cache_kbytes = parse_number(optarg, INT_MAX);
+            break;
+        case 'r':
+            driver_options.read_ahead = parse_number(optarg, INT_MAX);
+            break;
+        case 't':
+            driver_options.flush_time = parse_number(optarg, LLONG_MAX);
+            break;
+        case 'i':
+            driver_options.spin_down_time = parse_number(optarg, LLONG_MAX);
+            break;
+        case 'q':
+            use_classes = parse_number(optarg, INT_MAX);
+            break;
+        case 'o':
+            driver_options.p_stats_path = optarg;
+            break;
+        case 'x':
+            driver_options.p_trace_path = optarg;
+            break;
+        case 'y':
+            p_replay_path = optarg;
+            break;
+        case 'p':
+            if ((ring_producers = parse_number(optarg, INT_MAX)) < 1 ||
+                ring_producers > MAX_PRODUCERS)
+                count = 0;
+            break;
+        default:
+            count = 0;
+        }
+    }
+
+    /* A workload that is not one of ours is an error, not an empty   */
+    /* run                                                            */
+    if (p_only_workload != NULL)
+    {
+        for (type = 0; workload_type[type].p_name != NULL; type++)
+            if (strcmp(p_only_workload, workload_type[type].p_name) == 0)
+                break;
+        if (workload_type[type].p_name == NULL)
+            count = 0;
+    }
+
+    /* A replay runs on the disks and requests the trace recorded     */
+    p_workload = NULL;
+    if (p_replay_path != NULL && count > 0)
+        p_workload = load_trace(p_replay_path, &count);
+
+    /* Simulate the same disk the driver is told it has               */
+    load_geometry();
+    model.cylinders = disk_geometry.cylinders;
+    model.tracks_per_cylinder = disk_geometry.tracks_per_cylinder;
+    model.sectors_per_track = disk_geometry.sectors_per_track;
+    model.sectors_per_block = disk_geometry.sectors_per_block;
+    if (count < 1 || model.seek_error_interval < 0 ||
+        driver_options.pool_requests < 1 ||
+        driver_options.merge_blocks < 0 ||
+        driver_options.merge_blocks > disk_geometry.blocks_per_cylinder ||
+        driver_options.batch_size < 1 ||
+        driver_options.batch_size > MAX_PENDING_REQUESTS ||
+        driver_options.lookahead < 0 || driver_options.lookahead > 1 ||
+        driver_options.devices < 1 || driver_options.devices > MAX_DEVICES ||
+        driver_options.cache_kbytes < 0 || driver_options.read_ahead < 0 ||
+        driver_options.flush_time < 0 ||
+        driver_options.spin_down_time < 0 || use_classes < 0 ||
+        use_classes > 1)
+    {
+        printf("\nUsage: %s [-c requests] [-w workload] [-s policy] "
+               "[-f seek_error_interval] [-n pool_requests] "
+               "[-m merge_blocks] [-b batch_size] "
+               "[-l 0|1] [-d drives] "
+               "[-g cylinders,tracks,sectors,sectors_per_block] "
+               "[-k cache_kbytes] [-r read_ahead] [-t flush_time] "
+               "[-i spin_down_time] [-q 0|1] [-o stats_file] "
+               "[-x trace_file] [-y trace_file] [-p ring_producers]\n",
+               argv[0]);
+        exit(BENCH_ERR);
+    }
+    if (driver_options.merge_blocks == 0)
+        driver_options.merge_blocks = disk_geometry.blocks_per_cylinder;
+
+    if (ring_producers > 0)
+    {
+        run_ring_benchmark(ring_producers);
+        return 0;
+    }
+
+    if (p_workload == NULL &&
+        (p_workload = malloc(count * sizeof(WORKLOAD_REQUEST))) == NULL)
+    {
+        printf("\nUnable to allocate memory for the workload.\n");
+        exit(BENCH_ERR);
+    }
+
+    printf("%-10s %-8s %8s %9s %9s %9s %6s %8s %6s %6s %6s %6s %6s %6s "
+           "%7s %6s %8s %6s %7s %6s %6s\n",
+           "workload", "policy", "req/s", "mean ms", "p99 ms", "urgent ms",
+           "missed", "travel", "seeks", "xfers", "gap us", "msgs", "polls",
+           "recal", "held", "ra hit", "ra waste", "spins", "joules",
+           "saved", "errors");
+
+    if (p_replay_path != NULL)
+    {
+        run_policies("replay", &model, p_workload, count, only_policy,
+                     use_classes);
+        free(p_workload);
+        return 0;
+    }
+
+    /* Run every policy over the same script for each workload        */
+    for (type = 0; workload_type[type].p_name != NULL; type++)
+    {
+        if (p_only_workload != NULL &&
+            strcmp(p_only_workload, workload_type[type].p_name) != 0)
+            continue;
+
+        seed = type + 1;
+        reset_classes(p_workload, count);
+        workload_type[type].p_generate(p_workload, count, &model, &seed);
+        spread_workload(p_workload, count, driver_options.devices, &seed);
+
+        run_policies(workload_type[type].p_name, &model, p_workload, count,
+                     only_policy, use_classes);
+    }
+
+    free(p_workload);
+    return 0;
+}
+
+/**********************************************************************/
+/*      Script one reader walking the disk a cylinder at a time       */
+/**********************************************************************/
+void generate_sequential(WORKLOAD_REQUEST *p_workload, int count,
+                         DISK_MODEL *p_model, unsigned long long *p_seed)
+{
+    int blocks_per_cylinder = p_model->tracks_per_cylinder *
+                              p_model->sectors_per_track /
+                              p_model->sectors_per_block;
+                                /* Blocks in each cylinder            */
+    int request;                /* Count the requests                 */
+
+    (void)p_seed;
+    for (request = 0; request < count; request++)
+    {
+        p_workload[request].arrival_time =
+            (long long)(request / blocks_per_cylinder) * SEQUENTIAL_GROUP_TIME;
+        p_workload[request].operation_code = 1;
+        p_workload[request].block_number =
+            request % (p_model->cylinders * blocks_per_cylinder) + 1;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*        Script reads and writes spread evenly over the disk         */
+/**********************************************************************/
+void generate_random(WORKLOAD_REQUEST *p_workload, int count,
+                     DISK_MODEL *p_model, unsigned long long *p_seed)
+{
+    int block_count = p_model->cylinders * p_model->tracks_per_cylinder *
+                      p_model->sectors_per_track /
+                      p_model->sectors_per_block;
+                                /* Blocks on the disk                 */
+    long long arrival_time = 0; /* When the next request arrives      */
+    int request;                /* Count the requests                 */
+
+    for (request = 0; request < count; request++)
+    {
+        arrival_time += sim_random(p_seed) % (2 * RANDOM_ARRIVAL_TIME);
+        p_workload[request].arrival_time = arrival_time;
+        p_workload[request].operation_code = random_operation(p_seed);
+        p_workload[request].block_number =
+            sim_random(p_seed) % block_count + 1;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/* Script requests crowding a few cylinders in the middle of the disk */
+/**********************************************************************/
+void generate_hot_spot(WORKLOAD_REQUEST *p_workload, int count,
+                       DISK_MODEL *p_model, unsigned long long *p_seed)
+{
+    int blocks_per_cylinder = p_model->tracks_per_cylinder *
+                              p_model->sectors_per_track /
+                              p_model->sectors_per_block;
+                                /* Blocks in each cylinder            */
+    long long arrival_time = 0; /* When the next request arrives      */
+    int hot_cylinders = HOT_SPOT_CYLINDERS,
+                                /* Cylinders in the hot spot          */
+        first_hot_cylinder,     /* The hot spot's lowest cylinder     */
+        request;                /* Count the requests                 */
+
+    /* Keep the hot spot on a disk with fewer cylinders than it has   */
+    if (hot_cylinders > p_model->cylinders)
+        hot_cylinders = p_model->cylinders;
+    first_hot_cylinder = p_model->cylinders / 2;
+    if (first_hot_cylinder + hot_cylinders > p_model->cylinders)
+        first_hot_cylinder = p_model->cylinders - hot_cylinders;
+
+    for (request = 0; request < count; request++)
+    {
+        arrival_time += sim_random(p_seed) % (2 * HOT_SPOT_ARRIVAL_TIME);
+        p_workload[request].arrival_time = arrival_time;
+        p_workload[request].operation_code = random_operation(p_seed);
+        if (sim_random(p_seed) % 100 < HOT_SPOT_PERCENT)
+            p_workload[request].block_number =
+                first_hot_cylinder * blocks_per_cylinder +
+                sim_random(p_seed) % (hot_cylinders * blocks_per_cylinder) +
+                1;
+        else
+            p_workload[request].block_number =
+                sim_random(p_seed) %
+                    (p_model->cylinders * blocks_per_cylinder) + 1;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*   Script bursts of random requests with long quiet times between   */
+/**********************************************************************/
+void generate_bursty(WORKLOAD_REQUEST *p_workload, int count,
+                     DISK_MODEL *p_model, unsigned long long *p_seed)
+{
+    int block_count = p_model->cylinders * p_model->tracks_per_cylinder *
+                      p_model->sectors_per_track /
+                      p_model->sectors_per_block;
+                                /* Blocks on the disk                 */
+    long long arrival_time = 0; /* When the current burst arrives     */
+    int request;                /* Count the requests                 */
+
+    for (request = 0; request < count; request++)
+    {
+        if (request > 0 && request % BURST_REQUESTS == 0)
+            arrival_time += BURST_GAP_TIME +
+                            sim_random(p_seed) % (2 * BURST_GAP_TIME);
+        p_workload[request].arrival_time = arrival_time;
+        p_workload[request].operation_code = random_operation(p_seed);
+        p_workload[request].block_number =
+            sim_random(p_seed) % block_count + 1;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*  Script readers each reading their own part of the disk a block at */
+/*                               a time                               */
+/**********************************************************************/
+void generate_stream(WORKLOAD_REQUEST *p_workload, int count,
+                     DISK_MODEL *p_model, unsigned long long *p_seed)
+{
+    int block_count = p_model->cylinders * p_model->tracks_per_cylinder *
+                      p_model->sectors_per_track /
+                      p_model->sectors_per_block;
+                                /* Blocks on the disk                 */
+    int request;                /* Count the requests                 */
+
+    (void)p_seed;
+    for (request = 0; request < count; request++)
+    {
+        p_workload[request].arrival_time =
+            (long long)request * STREAM_ARRIVAL_TIME / STREAM_READERS;
+        p_workload[request].operation_code = 1;
+        p_workload[request].block_number =
+            (request % STREAM_READERS * (block_count / STREAM_READERS) +
+             request / STREAM_READERS) % block_count + 1;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*              Return a read or write for a random request           */
+/**********************************************************************/
+int random_operation(unsigned long long *p_seed)
+{
+    return sim_random(p_seed) % 100 < READ_PERCENT ? 1 : 2;
+}
+
+/**********************************************************************/
+/*  Script urgent random reads with deadlines among a background      */
+/*                   writer's sequential writes                       */
+/**********************************************************************/
+void generate_mixed(WORKLOAD_REQUEST *p_workload, int count,
+                    DISK_MODEL *p_model, unsigned long long *p_seed)
+{
+    int block_count = p_model->cylinders * p_model->tracks_per_cylinder *
+                      p_model->sectors_per_track /
+                      p_model->sectors_per_block;
+                                /* Blocks on the disk                 */
+    int next_write = 0,         /* The writer's next block, from 0    */
+        request;                /* Count the requests                 */
+
+    for (request = 0; request < count; request++)
+    {
+        p_workload[request].arrival_time =
+            (long long)request * MIXED_ARRIVAL_TIME;
+        if (sim_random(p_seed) % 100 < MIXED_URGENT_PERCENT)
+        {
+            p_workload[request].operation_code = 1;
+            p_workload[request].block_number =
+                sim_random(p_seed) % block_count + 1;
+            p_workload[request].priority = PRIORITY_URGENT;
+            p_workload[request].deadline_time = MIXED_DEADLINE_TIME;
+        }
+        else
+        {
+            p_workload[request].operation_code = 2;
+            p_workload[request].block_number = next_write++ % block_count + 1;
+            p_workload[request].priority = PRIORITY_BACKGROUND;
+        }
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*       Script every request as an ordinary one with no deadline     */
+/**********************************************************************/
+void reset_classes(WORKLOAD_REQUEST *p_workload, int count)
+{
+    int request; /* Count the scripted requests                       */
+
+    for (request = 0; request < count; request++)
+    {
+        p_workload[request].priority = PRIORITY_NORMAL;
+        p_workload[request].deadline_time = 0;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*  Spread a workload over the drives, each at one drive's full rate  */
+/**********************************************************************/
+void spread_workload(WORKLOAD_REQUEST *p_workload, int count, int drives,
+                     unsigned long long *p_seed)
+{
+    int request; /* Count the scripted requests                       */
+
+    for (request = 0; request < count; request++)
+    {
+        p_workload[request].arrival_time /= drives;
+        p_workload[request].device_number = sim_random(p_seed) % drives;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*  Read the messages of a driver trace into a workload, taking the   */
+/*                 disks the trace was recorded on                    */
+/**********************************************************************/
+WORKLOAD_REQUEST *load_trace(char *p_path, int *p_count)
+{
+    WORKLOAD_REQUEST *p_workload;  /* The traced requests             */
+    TRACE_HEADER *p_header;        /* The trace's header, mapped      */
+    TRACE_RECORD *p_record;        /* Points to a trace record        */
+    struct stat trace_status;      /* The trace file's size           */
+    void *p_map = MAP_FAILED;      /* The whole trace, mapped         */
+    char geometry[64];             /* The traced geometry, as -g      */
+                                   /* would give it                   */
+    long long travel = 0;          /* Cylinders the traced heads      */
+                                   /* moved across                    */
+    int heads[MAX_DEVICES] = {0},  /* Where each traced disk's heads  */
+                                   /* are                             */
+        file,                      /* The trace file                  */
+        record_count = 0,          /* Records in the trace            */
+        commands = 0,              /* Device commands in the trace    */
+        record,                    /* Count the records               */
+        request = 0;               /* Count the traced requests       */
+
+    /* Map the trace and check it was written by this driver          */
+    if ((file = open(p_path, O_RDONLY)) >= 0 &&
+        fstat(file, &trace_status) == 0 &&
+        trace_status.st_size >= (off_t)sizeof(TRACE_HEADER))
+        p_map = mmap(NULL, trace_status.st_size, PROT_READ, MAP_PRIVATE,
+                     file, 0);
+    if (file >= 0)
+        close(file);
+    if (p_map == MAP_FAILED)
+    {
+        printf("\nUnable to read the trace %s.\n", p_path);
+        exit(BENCH_ERR);
+    }
+    p_header = (TRACE_HEADER *)p_map;
+    p_record = (TRACE_RECORD *)(p_header + 1);
+    if (memcmp(p_header->magic, TRACE_MAGIC, sizeof(p_header->magic)) == 0 &&
+        p_header->record_bytes == sizeof(TRACE_RECORD))
+        record_count = (trace_status.st_size - sizeof(TRACE_HEADER)) /
+                       sizeof(TRACE_RECORD);
+    snprintf(geometry, sizeof(geometry), "%d,%d,%d,%d", p_header->cylinders,
+             p_header->tracks_per_cylinder, p_header->sectors_per_track,
+             p_header->sectors_per_block);
+    for (record = 0; record < record_count; record++)
+        if (p_record[record].kind == TRACE_MESSAGE)
+            request += 1;
+    if (record_count == 0 || p_header->devices < 1 ||
+        p_header->devices > MAX_DEVICES ||
+        !parse_geometry(geometry, &disk_geometry) || request == 0)
+    {
+        printf("\nThe file %s is not a driver trace with messages in it.\n",
+               p_path);
+        exit(BENCH_ERR);
+    }
+    driver_options.devices = p_header->devices;
+
+    if ((p_workload = malloc(request * sizeof(WORKLOAD_REQUEST))) == NULL)
+    {
+        printf("\nUnable to allocate memory for the workload.\n");
+        exit(BENCH_ERR);
+    }
+
+    /* Submit each message as long after tracing started as it was    */
+    /* taken in, which keeps the disk's rotation where it was, and    */
+    /* follow the traced heads for the summary                        */
+    request = 0;
+    for (record = 0; record < record_count; record++, p_record++)
+    {
+        if (p_record->kind == TRACE_MESSAGE)
+        {
+            p_workload[request].arrival_time =
+                p_record->time - p_header->start_time;
+            p_workload[request].operation_code = p_record->operation_code;
+            p_workload[request].device_number = p_record->device_number;
+            p_workload[request].block_number = (int)p_record->value[0];
+            p_workload[request].priority = (int)p_record->value[1];
+            p_workload[request].deadline_time = p_record->value[2];
+            request += 1;
+            continue;
+        }
+
+        commands += 1;
+        if (p_record->device_number < 0 ||
+            p_record->device_number >= p_header->devices)
+            continue;
+        if (p_record->operation_code == SENSE_CYLINDER)
+            heads[p_record->device_number] = p_record->result;
+        else if (p_record->operation_code == RECALIBRATE)
+            heads[p_record->device_number] = 0;
+        else if (p_record->operation_code == SEEK_TO_CYLINDER)
+        {
+            travel += llabs(p_record->value[0] -
+                            heads[p_record->device_number]);
+            heads[p_record->device_number] = p_record->result;
+        }
+    }
+
+    printf("trace %s: %d requests over %.3f s on %d drives of %s, "
+           "%d device commands, %lld cylinders traveled\n",
+           p_path, request, p_workload[request - 1].arrival_time / 1e6,
+           p_header->devices, geometry, commands, travel);
+    munmap(p_map, trace_status.st_size);
+
+    *p_count = request;
+    return p_workload;
+}
+
+/**********************************************************************/
+/* Run each policy, or just the one asked for, over a workload and    */
+/*                       print a line for each                        */
+/**********************************************************************/
+void run_policies(char *p_name, DISK_MODEL *p_model,
+                  WORKLOAD_REQUEST *p_workload, int count, int only_policy,
+                  bool send_classes)
+{
+    SIM_RESULT result;  /* One run's results                          */
+    FILE *p_stats_file; /* Takes each run's name                      */
+    int policy;         /* Count the policies                         */
+
+    for (policy = 0; p_policy_name[policy] != NULL; policy++)
+    {
+        if (only_policy >= 0 && policy != only_policy)
+            continue;
+
+        driver_options.policy = policy;
+
+        /* Name the run ahead of the statistics its driver adds       */
+        if (driver_options.p_stats_path != NULL &&
+            (p_stats_file = fopen(driver_options.p_stats_path, "a")) != NULL)
+        {
+            fprintf(p_stats_file, "run %s %s\n", p_name,
+                    p_policy_name[policy]);
+            fclose(p_stats_file);
+        }
+
+        if (!run_benchmark(p_model, p_workload, count, send_classes,
+                           &result))
+        {
+            printf("%-10s %-8s run failed\n", p_name, p_policy_name[policy]);
+            continue;
+        }
+
+        printf("%-10s %-8s %8.2f %9.1f %9.1f %9.1f %6d %8lld %6lld "
+               "%6lld %6lld %6lld %6lld %6lld %7d %6lld %8lld %6lld "
+               "%7.1f %6lld %6d%s\n",
+               p_name, p_policy_name[policy],
+               result.completed / (result.elapsed_time / 1e6),
+               result.total_latency / 1e3 / result.completed,
+               result.p99_latency / 1e3,
+               result.class_completed[PRIORITY_URGENT] > 0 ?
+                   result.class_latency[PRIORITY_URGENT] / 1e3 /
+                       result.class_completed[PRIORITY_URGENT] : 0.0,
+               result.deadline_misses, result.head_travel,
+               result.seeks, result.transfers,
+               result.gaps > 0 ? result.gap_time / result.gaps : 0,
+               result.messages,
+               result.busy_polls, result.recalibrations,
+               result.refused, result.read_ahead_hits,
+               result.read_ahead_waste, result.spin_ups,
+               result.motor_energy / 1e9, result.saved_operations,
+               result.data_errors + result.failed,
+               result.timed_out ? " timed out" : "");
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*         Run the driver over one workload in a child process        */
+/**********************************************************************/
+bool run_benchmark(DISK_MODEL *p_model, WORKLOAD_REQUEST *p_workload,
+                   int count, bool send_classes, SIM_RESULT *p_result)
+{
+    pid_t child;        /* The process running the driver             */
+    int result_pipe[2], /* Carries the results back from the child    */
+        status;         /* The child's exit status                    */
+    bool received;      /* The child sent back its results            */
+
+    fflush(stdout);
+    if (pipe(result_pipe) != 0 || (child = fork()) < 0)
+        return false;
+
+    if (child == 0)
+    {
+        close(result_pipe[0]);
+        start_simulation(p_model, driver_options.devices, p_workload, count,
+                         send_classes, result_pipe[1]);
+        run_driver();
+        _exit(BENCH_ERR);
+    }
+
+    close(result_pipe[1]);
+    received = read(result_pipe[0], p_result, sizeof(SIM_RESULT)) ==
+               sizeof(SIM_RESULT);
+    close(result_pipe[0]);
+    waitpid(child, &status, 0);
+
+    return received && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**********************************************************************/
+/*  Time and check messages sent by many threads at once through the  */
+/*        submission ring and back through the completion ring        */
+/**********************************************************************/
+void run_ring_benchmark(int producers)
+{
+    RING_THREAD producer[MAX_PRODUCERS], /* The producer threads      */
+        reaper;                          /* Checks the replies        */
+    MESSAGE *p_message;                  /* Points to a message taken */
+    struct timespec start, end;          /* When the run began and    */
+                                         /* ended                     */
+    long long message_count,             /* Messages in the run       */
+        count_message,                   /* Count the messages passed */
+        full_count;                      /* Times a ring was full     */
+    double seconds;                      /* How long the run took     */
+    int run_producers,                   /* Producers in this run     */
+        count_producer;                  /* Count the producers       */
+
+    p_submit_ring = create_ring(RING_ENTRIES);
+    p_complete_ring = create_ring(RING_ENTRIES);
+    printf("%-9s %10s %8s %10s %10s %6s\n", "producers", "messages",
+           "seconds", "msgs/s", "ring full", "errors");
+
+    /* Double the producers each run, ending on the number asked for  */
+    for (run_producers = 1; run_producers <= producers;
+         run_producers = run_producers == producers ? producers + 1 :
+                         run_producers * 2 > producers ? producers :
+                         run_producers * 2)
+    {
+        message_count = (long long)run_producers * RING_BENCH_MESSAGES;
+        memset(&reaper, 0, sizeof(reaper));
+        reaper.producers = run_producers;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pthread_create(&reaper.thread, NULL, reap_messages, &reaper);
+        for (count_producer = 0; count_producer < run_producers;
+             count_producer++)
+        {
+            memset(&producer[count_producer], 0, sizeof(RING_THREAD));
+            producer[count_producer].thread_number = count_producer;
+            pthread_create(&producer[count_producer].thread, NULL,
+                           produce_messages, &producer[count_producer]);
+        }
+
+        /* Play the driver, passing every message straight back       */
+        full_count = 0;
+        for (count_message = 0; count_message < message_count;)
+        {
+            if ((p_message = peek_ring(p_submit_ring)) == NULL)
+            {
+                sched_yield();
+                continue;
+            }
+            if (!push_ring(p_complete_ring, p_message))
+            {
+                full_count++;
+                sched_yield();
+                continue;
+            }
+            pop_ring(p_submit_ring);
+            count_message++;
+        }
+
+        for (count_producer = 0; count_producer < run_producers;
+             count_producer++)
+        {
+            pthread_join(producer[count_producer].thread, NULL);
+            full_count += producer[count_producer].full_count;
+        }
+        pthread_join(reaper.thread, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        seconds = (end.tv_sec - start.tv_sec) +
+                  (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%-9d %10lld %8.3f %10.0f %10lld %6lld\n", run_producers,
+               message_count, seconds, message_count / seconds, full_count,
+               reaper.errors);
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*   Send one producer's numbered messages into the submission ring   */
+/**********************************************************************/
+void *produce_messages(void *p_argument)
+{
+    RING_THREAD *p_producer = p_argument; /* The producer             */
+    MESSAGE message;                      /* The message to send      */
+
+    memset(&message, 0, sizeof(message));
+    message.operation_code = 1;
+    message.device_number = p_producer->thread_number;
+    for (message.request_number = 1;
+         message.request_number <= RING_BENCH_MESSAGES;
+         message.request_number++)
+        while (!push_ring(p_submit_ring, &message))
+        {
+            p_producer->full_count++;
+            sched_yield();
+        }
+
+    return NULL;
+}
+
+/**********************************************************************/
+/* Take the replies off the completion ring and check each producer's */
+/*                  arrive complete and in order                      */
+/**********************************************************************/
+void *reap_messages(void *p_argument)
+{
+    RING_THREAD *p_reaper = p_argument; /* The reaper                 */
+    MESSAGE *p_message;                 /* Points to a reply          */
+    int next_number[MAX_PRODUCERS],     /* The number each producer   */
+                                        /* sends next                 */
+        count_producer;                 /* Count the producers        */
+    long long count_message;            /* Count the replies          */
+
+    for (count_producer = 0; count_producer < p_reaper->producers;
+         count_producer++)
+        next_number[count_producer] = 1;
+
+    for (count_message = 0;
+         count_message < (long long)p_reaper->producers * RING_BENCH_MESSAGES;)
+    {
+        if ((p_message = peek_ring(p_complete_ring)) == NULL)
+        {
+            sched_yield();
+            continue;
+        }
+        if (p_message->device_number < 0 ||
+            p_message->device_number >= p_reaper->producers ||
+            p_message->request_number !=
+                next_number[p_message->device_number]++)
+            p_reaper->errors++;
+        pop_ring(p_complete_ring);
+        count_message++;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,563 @@
+/**********************************************************************/
+/*                                                                    */
+/* Module Name:  cache - Per device block cache with write back       */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This module keeps a fixed number of recently used blocks for each  */
+/* device, found through a hash table by block number.  Reads of a    */
+/* cached block are copied straight out without touching the disk,    */
+/* and a read that misses claims a block for its data to fill once it */
+/* comes back.  Writes are copied into the cache and finished at      */
+/* once, and the block's own write back request goes on the pending   */
+/* queue, so the elevator writes dirty blocks back in its usual order */
+/* and merges them with their neighbours.  Writing a block again      */
+/* before its write back starts only changes the cached data.         */
+/*                                                                    */
+/* A write that cannot be cached, because its block is being written  */
+/* back or nothing can be evicted, goes to the disk itself.  Later    */
+/* writes to the block follow it around the cache until it finishes,  */
+/* so writes to one block always reach the disk in arrival order.     */
+/* Writes sent around with no cache block to count them on keep any   */
+/* new block from being cached until they are all finished.           */
+/*                                                                    */
+/* Clean blocks sit on a least recently used list and are the only    */
+/* ones ever evicted.  Dirty blocks sit on a second list in the order */
+/* they were dirtied, which tells a sync when every write cached      */
+/* before it is back on the disk.                                     */
+/*                                                                    */
+/* The cache also follows a few runs of ascending reads.  When the    */
+/* device reads for a run, the transfer goes on through the rest of   */
+/* the cylinder into blocks claimed here, so the run's next reads are */
+/* hits.  A read that arrives while its block is still on the way in  */
+/* waits on the block instead of going to the disk a second time.     */
+/* Blocks read ahead are counted when a read uses them and when they  */
+/* are evicted or overwritten unread.                                 */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "driver.h"
+
+/**********************************************************************/
+/*  Create an empty block cache holding the given number of blocks    */
+/**********************************************************************/
+BLOCK_CACHE *create_cache(int block_count)
+{
+    BLOCK_CACHE *p_new_cache; /* Points to the new cache              */
+    char *p_data = NULL;      /* Points to the blocks' data           */
+    int bucket_count = 1,     /* Hash buckets, a power of two         */
+        count_block;          /* Count the cached blocks              */
+
+    while (bucket_count < block_count)
+        bucket_count *= 2;
+
+    if ((p_new_cache = (BLOCK_CACHE *)calloc(1, sizeof(BLOCK_CACHE) +
+                                             block_count *
+                                                 sizeof(CACHE_BLOCK)))
+        == NULL ||
+        (p_new_cache->p_hash_bucket = (CACHE_BLOCK **)
+             calloc(bucket_count, sizeof(CACHE_BLOCK *))) == NULL ||
+        (p_data = (char *)malloc((size_t)block_count *
+                                 disk_geometry.bytes_per_block)) == NULL)
+    {
+        printf("\nError #%d occurred in create_cache.", CACHE_ALLOC_ERR);
+        printf("\nUnable to allocate memory for the block cache.");
+        printf("\nThe program is aborting.");
+        exit(CACHE_ALLOC_ERR);
+    }
+
+    /* Chain every cache block onto the free list                     */
+    p_new_cache->block_count = block_count;
+    p_new_cache->hash_mask = bucket_count - 1;
+    for (count_block = block_count - 1; count_block >= 0; count_block--)
+    {
+        p_new_cache->cache_block[count_block].p_data =
+            (unsigned long int *)(p_data + (size_t)count_block *
+                                               disk_geometry.bytes_per_block);
+        p_new_cache->cache_block[count_block].p_newer =
+            p_new_cache->p_free_block;
+        p_new_cache->p_free_block = &p_new_cache->cache_block[count_block];
+    }
+
+    return p_new_cache;
+}
+
+/**********************************************************************/
+/*      Return the cached copy of a block, or NULL if there is none   */
+/**********************************************************************/
+CACHE_BLOCK *find_cached_block(BLOCK_CACHE *p_cache, int block_number)
+{
+    CACHE_BLOCK *p_block; /* Points to the block being checked        */
+
+    for (p_block = p_cache->p_hash_bucket[block_number & p_cache->hash_mask];
+         p_block != NULL && p_block->block_number != block_number;
+         p_block = p_block->p_next_hash)
+        ;
+
+    return p_block;
+}
+
+/**********************************************************************/
+/*    Make a block the newest on a list of clean or dirty blocks      */
+/**********************************************************************/
+void link_cached_block(CACHE_BLOCK **p_p_newest, CACHE_BLOCK **p_p_oldest,
+                       CACHE_BLOCK *p_block)
+{
+    p_block->p_newer = NULL;
+    p_block->p_older = *p_p_newest;
+    if (*p_p_newest == NULL)
+        *p_p_oldest = p_block;
+    else
+        (*p_p_newest)->p_newer = p_block;
+    *p_p_newest = p_block;
+
+    return;
+}
+
+/**********************************************************************/
+/*       Take a block off a list of clean or dirty blocks             */
+/**********************************************************************/
+void unlink_cached_block(CACHE_BLOCK **p_p_newest, CACHE_BLOCK **p_p_oldest,
+                         CACHE_BLOCK *p_block)
+{
+    if (p_block->p_newer == NULL)
+        *p_p_newest = p_block->p_older;
+    else
+        p_block->p_newer->p_older = p_block->p_older;
+
+    if (p_block->p_older == NULL)
+        *p_p_oldest = p_block->p_newer;
+    else
+        p_block->p_older->p_newer = p_block->p_newer;
+
+    return;
+}
+
+/**********************************************************************/
+/*        Take a block out of the hash table so it is not found       */
+/**********************************************************************/
+void drop_cached_block(BLOCK_CACHE *p_cache, CACHE_BLOCK *p_block)
+{
+    CACHE_BLOCK **p_p_link; /* Points to the link to the block        */
+
+    for (p_p_link =
+             &p_cache->p_hash_bucket[p_block->block_number &
+                                     p_cache->hash_mask];
+         *p_p_link != p_block; p_p_link = &(*p_p_link)->p_next_hash)
+        ;
+    *p_p_link = p_block->p_next_hash;
+
+    return;
+}
+
+/**********************************************************************/
+/*   Give a block a cache block of its own, evicting the least recent */
+/*      clean block if none is free, or return NULL if none can go    */
+/**********************************************************************/
+CACHE_BLOCK *take_cache_block(BLOCK_CACHE *p_cache, int block_number)
+{
+    CACHE_BLOCK *p_block; /* Points to the block handed out           */
+    int bucket;           /* The block number's hash bucket           */
+
+    if ((p_block = p_cache->p_free_block) != NULL)
+        p_cache->p_free_block = p_block->p_newer;
+    else if ((p_block = p_cache->p_least_recent) != NULL)
+    {
+        unlink_cached_block(&p_cache->p_most_recent,
+                            &p_cache->p_least_recent, p_block);
+        drop_cached_block(p_cache, p_block);
+        if (p_block->read_ahead)
+            p_cache->read_ahead_waste += 1;
+    }
+    else
+        return NULL;
+
+    p_block->block_number = block_number;
+    p_block->state = 0;
+    p_block->writes_around = 0;
+    p_block->read_ahead = false;
+    p_block->p_first_waiting = NULL;
+    bucket = block_number & p_cache->hash_mask;
+    p_block->p_next_hash = p_cache->p_hash_bucket[bucket];
+    p_cache->p_hash_bucket[bucket] = p_block;
+
+    return p_block;
+}
+
+/**********************************************************************/
+/*  Finish a read from the cache, hold it on a block being read, or   */
+/*                     queue it for the disk                          */
+/**********************************************************************/
+void read_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                       REQUEST *p_request)
+{
+    CACHE_BLOCK *p_block; /* Points to the cached block               */
+    REQUEST **p_p_link;   /* Points to the link to the next waiter    */
+
+    follow_stream(p_cache, p_request->block_number);
+    if ((p_block = find_cached_block(p_cache, p_request->block_number))
+        != NULL && p_block->writes_around == 0)
+    {
+        /* A block on its way in from the disk, asked for or read     */
+        /* ahead, holds the read until its data arrives               */
+        if (p_block->state == CACHE_READING)
+        {
+            for (p_p_link = &p_block->p_first_waiting; *p_p_link != NULL;
+                 p_p_link = &(*p_p_link)->p_next_request)
+                ;
+            p_request->p_next_request = NULL;
+            *p_p_link = p_request;
+            return;
+        }
+
+        memcpy(p_request->p_data_address, p_block->p_data,
+               disk_geometry.bytes_per_block);
+        if (p_block->state == CACHE_CLEAN)
+        {
+            unlink_cached_block(&p_cache->p_most_recent,
+                                &p_cache->p_least_recent, p_block);
+            link_cached_block(&p_cache->p_most_recent,
+                              &p_cache->p_least_recent, p_block);
+        }
+        if (p_block->read_ahead)
+        {
+            p_block->read_ahead = false;
+            p_cache->read_ahead_hits += 1;
+        }
+        p_cache->read_hits += 1;
+        finish_pending_request(p_request, p_queue, 0);
+        return;
+    }
+
+    p_cache->read_misses += 1;
+    if (p_block == NULL && p_cache->untracked_writes == 0 &&
+        (p_block = take_cache_block(p_cache, p_request->block_number))
+        != NULL)
+        p_block->state = CACHE_READING;
+    add_pending_request(p_queue, p_request);
+
+    return;
+}
+
+/**********************************************************************/
+/* Take a write into the cache and queue its write back, or queue the */
+/*                  write itself for the disk                         */
+/**********************************************************************/
+void write_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                        REQUEST *p_request)
+{
+    CACHE_BLOCK *p_block; /* Points to the cached block               */
+    REQUEST *p_flush,     /* Points to the block's write back         */
+        *p_waiting;       /* Points to a read waiting on the block    */
+
+    /* Send the write around the cache, counted on its block, when    */
+    /* the device may be reading the block's data right now or other  */
+    /* writes to the block are still on their way around              */
+    if ((p_block = find_cached_block(p_cache, p_request->block_number))
+        == NULL)
+    {
+        if (p_cache->untracked_writes > 0 ||
+            (p_block = take_cache_block(p_cache, p_request->block_number))
+            == NULL)
+        {
+            p_cache->untracked_writes += 1;
+            add_pending_request(p_queue, p_request);
+            return;
+        }
+    }
+    else if (p_block->state == CACHE_FLUSHING ||
+             p_block->state == CACHE_WRITING)
+    {
+        p_block->writes_around += 1;
+        add_pending_request(p_queue, p_request);
+        return;
+    }
+
+    /* Reads held for the block's old data go to the disk for it,     */
+    /* ahead of the write back queued behind them                     */
+    while ((p_waiting = p_block->p_first_waiting) != NULL)
+    {
+        p_block->p_first_waiting = p_waiting->p_next_request;
+        add_pending_request(p_queue, p_waiting);
+    }
+
+    memcpy(p_block->p_data, p_request->p_data_address,
+           disk_geometry.bytes_per_block);
+    p_cache->write_sequence += 1;
+    p_cache->absorbed_writes += 1;
+    finish_pending_request(p_request, p_queue, 0);
+
+    /* A block already dirty is written back with its new data        */
+    if (p_block->state == CACHE_DIRTY)
+        return;
+
+    if (p_block->state == CACHE_CLEAN)
+        unlink_cached_block(&p_cache->p_most_recent,
+                            &p_cache->p_least_recent, p_block);
+    if (p_block->read_ahead)
+    {
+        p_block->read_ahead = false;
+        p_cache->read_ahead_waste += 1;
+    }
+    p_block->state = CACHE_DIRTY;
+    p_block->dirty_sequence = p_cache->write_sequence;
+    link_cached_block(&p_cache->p_last_dirty, &p_cache->p_first_dirty,
+                      p_block);
+
+    /* Queue the write back as a request of its own                   */
+    p_flush = &p_block->flush_request;
+    *p_flush = *p_request;
+    p_flush->p_data_address = p_block->p_data;
+    p_flush->p_cache_block = p_block;
+    p_flush->priority = PRIORITY_BACKGROUND;
+    p_flush->deadline = -1;
+    add_pending_request(p_queue, p_flush);
+
+    return;
+}
+
+/**********************************************************************/
+/*        Bring the cache up to date with a finished read or write    */
+/**********************************************************************/
+void fill_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                       REQUEST *p_request, int error_code)
+{
+    CACHE_BLOCK *p_block; /* Points to the cached block               */
+
+    p_block = find_cached_block(p_cache, p_request->block_number);
+    if (p_request->operation_code == 2)
+    {
+        if (p_block == NULL || p_block->writes_around == 0)
+        {
+            p_cache->untracked_writes -= 1;
+            return;
+        }
+
+        /* Wait for the last write sent around before using its data  */
+        if (--p_block->writes_around > 0 ||
+            p_block->state != CACHE_WRITING)
+            return;
+    }
+    else if (p_block == NULL || p_block->state != CACHE_READING)
+        return;
+
+    load_cached_block(p_cache, p_queue, p_block, p_request->p_data_address,
+                      error_code);
+
+    return;
+}
+
+/**********************************************************************/
+/*  Keep the data the disk now holds in a block and finish the reads  */
+/*  waiting on it, or give the block back if the disk failed to move  */
+/*                                 it                                 */
+/**********************************************************************/
+void load_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                       CACHE_BLOCK *p_block, unsigned long int *p_data,
+                       int error_code)
+{
+    REQUEST *p_waiting; /* Points to a read waiting on the block      */
+
+    if (error_code != 0)
+    {
+        /* The waiting reads try the disk themselves                  */
+        while ((p_waiting = p_block->p_first_waiting) != NULL)
+        {
+            p_block->p_first_waiting = p_waiting->p_next_request;
+            add_pending_request(p_queue, p_waiting);
+        }
+        drop_cached_block(p_cache, p_block);
+        p_block->p_newer = p_cache->p_free_block;
+        p_cache->p_free_block = p_block;
+        return;
+    }
+
+    memcpy(p_block->p_data, p_data, disk_geometry.bytes_per_block);
+    p_block->state = CACHE_CLEAN;
+    link_cached_block(&p_cache->p_most_recent, &p_cache->p_least_recent,
+                      p_block);
+    while ((p_waiting = p_block->p_first_waiting) != NULL)
+    {
+        p_block->p_first_waiting = p_waiting->p_next_request;
+        memcpy(p_waiting->p_data_address, p_block->p_data,
+               disk_geometry.bytes_per_block);
+        p_cache->read_hits += 1;
+        finish_pending_request(p_waiting, p_queue, 0);
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*  Mark a written back block clean and finish any syncs it releases  */
+/**********************************************************************/
+void flush_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                        CACHE_BLOCK *p_block, int error_code)
+{
+    REQUEST *p_sync; /* Points to the sync being finished             */
+
+    p_cache->flushes += 1;
+
+    /* Try a failed write back again unless newer writes were sent    */
+    /* around it in the meantime                                      */
+    if (error_code != 0)
+    {
+        p_cache->flush_errors += 1;
+        if (p_block->writes_around == 0)
+        {
+            p_block->state = CACHE_DIRTY;
+            add_pending_request(p_queue, &p_block->flush_request);
+            return;
+        }
+    }
+
+    unlink_cached_block(&p_cache->p_last_dirty, &p_cache->p_first_dirty,
+                        p_block);
+    if (p_block->writes_around > 0)
+        p_block->state = CACHE_WRITING;
+    else
+    {
+        p_block->state = CACHE_CLEAN;
+        link_cached_block(&p_cache->p_most_recent, &p_cache->p_least_recent,
+                          p_block);
+    }
+
+    /* Finish every sync no longer waiting on an older dirty block    */
+    while ((p_sync = p_cache->p_first_sync) != NULL &&
+           (p_cache->p_first_dirty == NULL ||
+            p_cache->p_first_dirty->dirty_sequence > p_sync->sync_sequence))
+    {
+        if ((p_cache->p_first_sync = p_sync->p_next_request) == NULL)
+            p_cache->p_last_sync = NULL;
+        finish_pending_request(p_sync, p_queue, 0);
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/* Finish a sync now, or hold it until the writes before it are back  */
+/**********************************************************************/
+void sync_cache(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                REQUEST *p_request)
+{
+    if (p_cache->p_first_dirty == NULL)
+    {
+        finish_pending_request(p_request, p_queue, 0);
+        return;
+    }
+
+    p_request->sync_sequence = p_cache->write_sequence;
+    p_request->p_next_request = NULL;
+    if (p_cache->p_last_sync == NULL)
+        p_cache->p_first_sync = p_request;
+    else
+        p_cache->p_last_sync->p_next_request = p_request;
+    p_cache->p_last_sync = p_request;
+
+    return;
+}
+
+/**********************************************************************/
+/*    Add a read to the stream it continues, or start a new stream    */
+/**********************************************************************/
+void follow_stream(BLOCK_CACHE *p_cache, int block_number)
+{
+    READ_STREAM *p_stream; /* Points to the stream being checked      */
+    int count_stream;      /* Count the streams                       */
+
+    for (count_stream = 0; count_stream < MAX_STREAMS; count_stream++)
+    {
+        p_stream = &p_cache->stream[count_stream];
+        if (p_stream->run_length > 0 && p_stream->next_block == block_number)
+        {
+            p_stream->next_block += 1;
+            p_stream->run_length += 1;
+            return;
+        }
+    }
+
+    /* Start a new run in place of the one started longest ago        */
+    p_stream = &p_cache->stream[p_cache->next_stream];
+    p_cache->next_stream = (p_cache->next_stream + 1) % MAX_STREAMS;
+    p_stream->next_block = block_number + 1;
+    p_stream->run_length = 1;
+
+    return;
+}
+
+/**********************************************************************/
+/*   Claim cache blocks for reading ahead from the given block if a   */
+/*     stream runs up to it, returning how many were claimed          */
+/**********************************************************************/
+int plan_read_ahead(BLOCK_CACHE *p_cache, int block_number)
+{
+    CACHE_BLOCK *p_block; /* Points to a block claimed to read into   */
+    int count_block = 0,  /* Count the blocks claimed                 */
+        count_stream,     /* Count the streams                        */
+        cylinder;         /* The cylinder the heads will be on        */
+
+    /* Only read ahead of a run that has read the block just before   */
+    for (count_stream = 0; count_stream < MAX_STREAMS; count_stream++)
+        if (p_cache->stream[count_stream].run_length >= READ_AHEAD_RUN &&
+            p_cache->stream[count_stream].next_block -
+                    p_cache->stream[count_stream].run_length <
+                block_number &&
+            block_number <= p_cache->stream[count_stream].next_block)
+            break;
+    if (count_stream == MAX_STREAMS)
+        return 0;
+
+    /* Read on through the cylinder the heads are already on, up to   */
+    /* the first block the cache has or cannot take                   */
+    cylinder = p_block_address[block_number - 2].cylinder;
+    while (count_block < driver_options.read_ahead &&
+           block_number + count_block <= disk_geometry.block_count &&
+           p_block_address[block_number + count_block - 1].cylinder ==
+               cylinder &&
+           p_cache->untracked_writes == 0 &&
+           find_cached_block(p_cache, block_number + count_block) == NULL &&
+           (p_block = take_cache_block(p_cache, block_number + count_block))
+           != NULL)
+    {
+        p_block->state = CACHE_READING;
+        count_block++;
+    }
+    p_cache->read_aheads += count_block;
+
+    return count_block;
+}
+
+/**********************************************************************/
+/*          Keep a block read ahead in the block claimed for it       */
+/**********************************************************************/
+void fill_read_ahead(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                     int block_number, unsigned long int *p_data,
+                     int error_code)
+{
+    CACHE_BLOCK *p_block; /* Points to the claimed block              */
+
+    /* A write may have taken the block over since it was claimed     */
+    if ((p_block = find_cached_block(p_cache, block_number)) == NULL ||
+        p_block->state != CACHE_READING)
+        return;
+
+    /* A block some read already waited on was read ahead in time    */
+    if (error_code == 0 && p_block->p_first_waiting != NULL)
+        p_cache->read_ahead_hits += 1;
+    else if (error_code == 0)
+        p_block->read_ahead = true;
+    load_cached_block(p_cache, p_queue, p_block, p_data, error_code);
+
+    return;
+}
@@ -0,0 +1,824 @@
+/**********************************************************************/
+/*                                                                    */
+/* Module Name:  disk_sim - Simulated disk device and file system     */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This module supplies disk_drive, notify_file_system, and           */
+/* wait_event on the host so the driver can be linked and measured    */
+/* without the real hardware.                                         */
+/*                                                                    */
+/* Up to MAX_DEVICES drives share one simulated clock.  Every command */
+/* costs a little time, seeks cost a settle time plus a time per      */
+/* cylinder, and reads and writes wait for their sector to come       */
+/* around before taking one sector time per sector.  Seeks overlap,   */
+/* so every drive's arm can be moving at once, and a transfer waits   */
+/* for its own drive's arm to stop.  Each busy poll moves the clock   */
+/* on by the command time, so a spinning driver pays for spinning,    */
+/* while a driver sleeping in wait_event is woken for free the moment */
+/* a drive finishes or the file system has requests.  The data really */
+/* moves between the caller's buffers and each drive's simulated      */
+/* platter, and every block carries a tag so reads can be checked.    */
+/* A motor draws the model's spin up power until it is up to speed    */
+/* and its running power from then until it is stopped.               */
+/*                                                                    */
+/* The file system side adds the script's requests to the submission  */
+/* ring as their arrival times pass, holding them back while the ring */
+/* is full, and takes every finished request off the completion ring  */
+/* when the driver notifies it.  When every request has been          */
+/* completed the results are written out and the process exits.       */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include "disk_sim.h"
+
+/**********************************************************************/
+/*                         Symbolic Constants                         */
+/**********************************************************************/
+#define REQUEST_WAITING 0       /* Not yet submitted to the driver    */
+#define REQUEST_SUBMITTED 1     /* Submitted and not yet completed    */
+#define REQUEST_DONE 2          /* Completed by the driver            */
+#define WRITE_OPERATION 2       /* File system write operation code   */
+
+/**********************************************************************/
+/*                         Program Structures                         */
+/**********************************************************************/
+/* The file system's view of one scripted request                     */
+struct sim_request
+{
+    int state,                         /* Waiting, submitted or done   */
+        request_number,                /* Number given on submission   */
+        version,                       /* Tag version written, or the  */
+                                       /* oldest a read may get back   */
+        write_epoch,                   /* Writes to the block seen     */
+                                       /* when a read was submitted    */
+        write_failures;                /* Failed writes seen when a    */
+                                       /* read was submitted           */
+    unsigned long int *p_buffer;       /* The request's data block     */
+};
+typedef struct sim_request SIM_REQUEST;
+
+/* A block tag stored at the front of every block's data              */
+struct block_tag
+{
+    int block_number, /* The block the data belongs to                 */
+        version;      /* Which write put it there, 0 for formatting    */
+};
+typedef struct block_tag BLOCK_TAG;
+
+/* The state of one simulated drive                                   */
+struct sim_drive
+{
+    long long motor_start_time,        /* When the motor was started   */
+        motor_ready_time,              /* When the motor reaches speed */
+        busy_until,                    /* When the busy command ends   */
+        seek_done,                     /* When the arm stops moving    */
+        transfer_end;                  /* When the last transfer ended */
+                                       /* less any seeks since, or -1  */
+                                       /* once the driver ran dry      */
+    int heads,                         /* Cylinder under the heads     */
+        busy_command,                  /* Command in progress, or 0    */
+        dma_sector,                    /* DMA starting sector          */
+        dma_track,                     /* DMA starting track           */
+        dma_length;                    /* DMA length in bytes          */
+    bool motor_on,                     /* The motor is powered         */
+         spinning_up,                  /* The motor has started and    */
+                                       /* not yet been seen at speed   */
+         dma_ready;                    /* A DMA transfer is set up     */
+    unsigned long int *p_dma_address;  /* DMA memory address           */
+    unsigned char *p_platter;          /* Contents of the whole disk   */
+};
+typedef struct sim_drive SIM_DRIVE;
+
+/* The whole state of the simulated devices and file system           */
+struct simulation
+{
+    DISK_MODEL model;                  /* Geometry and timings         */
+    WORKLOAD_REQUEST *p_workload;      /* The file system's script     */
+    SIM_REQUEST *p_request;            /* State of each request        */
+    SIM_RESULT result;                 /* Results gathered so far      */
+    long long now,                     /* The simulated clock          */
+        *p_latency;                    /* Latency of each completion   */
+    int request_count,                 /* Requests in the script       */
+        drives,                        /* Drives attached              */
+        next_arrival,                  /* Next request not yet         */
+                                       /* submitted                    */
+        result_file,                   /* Where the results go, or -1  */
+        request_index[MAX_REQUEST_NUM + 1], /* Request by its number   */
+        next_request_number,           /* Number for the next request  */
+        *p_block_latest,               /* Latest submitted write tag   */
+        *p_block_epoch,                /* Writes submitted per block   */
+        write_count,                   /* Writes submitted in all      */
+        write_failures,                /* Writes the driver failed     */
+        block_count,                   /* Blocks on each drive         */
+        blocks_per_cylinder;           /* Blocks in each cylinder      */
+    unsigned long long seed;           /* Seek error random sequence   */
+    bool send_classes;                 /* Tell the driver each         */
+                                       /* request's class and deadline */
+    SIM_DRIVE drive[MAX_DEVICES];      /* The drives, by device number */
+};
+typedef struct simulation SIMULATION;
+
+/**********************************************************************/
+/*                          Global Variables                          */
+/**********************************************************************/
+DISK_MODEL default_disk_model = {DEFAULT_CYLINDERS, DEFAULT_TRACKS,
+                                 DEFAULT_SECTORS, DEFAULT_SECTORS_PER_BLOCK,
+                                 BYTES_PER_SECTOR, 0, MOTOR_POWER,
+                                 SPIN_UP_POWER,
+                                 15000, 3000, 22222, 500000,
+                                 20, 100};
+                                /* 300 RPM, 3 ms per cylinder, half a */
+                                /* second to spin up                  */
+SIMULATION simulation;          /* The simulated device and file      */
+                                /* system                             */
+
+/**********************************************************************/
+/*                        Function Prototypes                         */
+/**********************************************************************/
+void *sim_allocate(size_t size);
+/* Allocate zeroed memory or abort the simulation                     */
+long long block_offset(int block_number);
+/* Return the platter offset of a block's first byte                  */
+int block_index(WORKLOAD_REQUEST *p_script);
+/* Return where a scripted request's block sits in the block tables   */
+void check_time_limit();
+/* Abandon a run that has gone on far too long                        */
+int submit_requests();
+/* Add the requests now due to the submission ring, returning how     */
+/* many went in                                                       */
+void deliver_request(int request, MESSAGE *p_message);
+/* Fill in a submission ring message for a request                    */
+void complete_request(int request, int error_code);
+/* Record a request the driver has completed                          */
+void finish_simulation();
+/* Report the results of the run and end the process                  */
+int compare_latency(const void *p_first, const void *p_second);
+/* Order two latencies for sorting                                    */
+long long motor_run_energy(SIM_DRIVE *p_drive);
+/* Return the energy a running motor has used since it was started    */
+
+/**********************************************************************/
+/*  Load the disk model, the drives, and the file system's script for */
+/* one run, telling the driver the script's priority classes and      */
+/*       deadlines or leaving every request an ordinary one           */
+/**********************************************************************/
+void start_simulation(DISK_MODEL *p_model, int drives,
+                      WORKLOAD_REQUEST *p_workload, int request_count,
+                      bool send_classes, int result_file)
+{
+    SIM_DRIVE *p_drive; /* Points to the drive being set up           */
+    BLOCK_TAG tag;      /* The formatting tag for a block             */
+    int drive,          /* Count the drives                           */
+        request;        /* Count the scripted requests                */
+
+    memset(&simulation, 0, sizeof(simulation));
+    simulation.model = *p_model;
+    simulation.drives = drives;
+    simulation.p_workload = p_workload;
+    simulation.request_count = request_count;
+    simulation.result_file = result_file;
+    simulation.send_classes = send_classes;
+    simulation.next_request_number = 1;
+    simulation.seed = 1;
+    simulation.blocks_per_cylinder = p_model->tracks_per_cylinder *
+                                     p_model->sectors_per_track /
+                                     p_model->sectors_per_block;
+    simulation.block_count = p_model->cylinders *
+                             simulation.blocks_per_cylinder;
+
+    simulation.p_request = sim_allocate(request_count * sizeof(SIM_REQUEST));
+    simulation.p_latency = sim_allocate(request_count * sizeof(long long));
+    simulation.p_block_latest =
+        sim_allocate(drives * (simulation.block_count + 1) * sizeof(int));
+    simulation.p_block_epoch =
+        sim_allocate(drives * (simulation.block_count + 1) * sizeof(int));
+    for (request = 0; request < request_count; request++)
+        simulation.p_request[request].p_buffer =
+            sim_allocate(p_model->sectors_per_block *
+                         p_model->bytes_per_sector);
+
+    /* Format every drive with a tag at the front of every block      */
+    for (drive = 0; drive < drives; drive++)
+    {
+        p_drive = &simulation.drive[drive];
+        p_drive->transfer_end = -1;
+        p_drive->p_platter = sim_allocate((size_t)p_model->cylinders *
+                                          p_model->tracks_per_cylinder *
+                                          p_model->sectors_per_track *
+                                          p_model->bytes_per_sector);
+        for (tag.block_number = 1;
+             tag.block_number <= simulation.block_count; tag.block_number++)
+        {
+            tag.version = 0;
+            memcpy(p_drive->p_platter + block_offset(tag.block_number),
+                   &tag, sizeof(tag));
+        }
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*        Return the next number from a repeatable random sequence    */
+/**********************************************************************/
+unsigned int sim_random(unsigned long long *p_seed)
+{
+    *p_seed = *p_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+
+    return (unsigned int)(*p_seed >> 33);
+}
+
+/**********************************************************************/
+/*          Send a command to a disk device and return its status     */
+/**********************************************************************/
+int disk_drive(int device_number, int operation_code, int argument_1,
+               int argument_2, int argument_3,
+               unsigned long int *p_data_address)
+{
+    DISK_MODEL *p_model = &simulation.model; /* The disk model        */
+    SIM_DRIVE *p_drive;  /* Points to the drive commanded             */
+    long long offset,    /* Platter offset of the transfer            */
+        start,           /* When a command can get going              */
+        angle,           /* Time into the current revolution          */
+        seek_time;       /* How long a seek takes                     */
+    int status = 0,      /* The status to return                      */
+        distance;        /* Cylinders crossed by a seek               */
+
+    simulation.now += p_model->command_time;
+    simulation.result.commands += 1;
+    check_time_limit();
+
+    if (device_number < 0 || device_number >= simulation.drives)
+        return -1;
+    p_drive = &simulation.drive[device_number];
+
+    switch (operation_code)
+    {
+    case SENSE_CYLINDER:
+        status = p_drive->heads;
+        break;
+
+    case SEEK_TO_CYLINDER:
+        /* The arm only moves with the motor up to speed and no       */
+        /* other command running.  The seek is overlapped, it returns */
+        /* at once with where the heads will land and later commands  */
+        /* wait for the arm to stop                                   */
+        if (p_drive->busy_command == 0 && p_drive->motor_on &&
+            simulation.now >= p_drive->motor_ready_time &&
+            argument_1 >= 0 && argument_1 < p_model->cylinders)
+        {
+            distance = abs(argument_1 - p_drive->heads);
+            if (distance > 0)
+            {
+                seek_time = p_model->seek_settle_time +
+                            distance * p_model->seek_cylinder_time;
+                p_drive->seek_done = (simulation.now > p_drive->seek_done ?
+                                      simulation.now : p_drive->seek_done) +
+                                     seek_time;
+                if (p_drive->transfer_end >= 0)
+                    p_drive->transfer_end += seek_time;
+                simulation.result.head_travel += distance;
+                simulation.result.seeks += 1;
+            }
+            p_drive->heads = argument_1;
+
+            /* Now and then land one cylinder off                     */
+            if (p_model->seek_error_interval > 0 &&
+                sim_random(&simulation.seed) %
+                        p_model->seek_error_interval == 0)
+                p_drive->heads = argument_1 == 0 ? 1 : argument_1 - 1;
+        }
+        status = p_drive->heads;
+        break;
+
+    case DMA_SETUP:
+        offset = ((long long)argument_2 * p_model->sectors_per_track +
+                  argument_1) * p_model->bytes_per_sector + argument_3;
+        if (p_drive->busy_command != 0 || argument_1 < 0 ||
+            argument_1 >= p_model->sectors_per_track || argument_2 < 0 ||
+            argument_3 <= 0 || argument_3 % p_model->bytes_per_sector != 0 ||
+            offset > (long long)p_model->tracks_per_cylinder *
+                     p_model->sectors_per_track * p_model->bytes_per_sector)
+        {
+            status = -1;
+            break;
+        }
+        p_drive->dma_sector = argument_1;
+        p_drive->dma_track = argument_2;
+        p_drive->dma_length = argument_3;
+        p_drive->p_dma_address = p_data_address;
+        p_drive->dma_ready = true;
+        break;
+
+    case START_MOTOR:
+        if (!p_drive->motor_on)
+        {
+            p_drive->motor_on = p_drive->spinning_up = true;
+            p_drive->motor_start_time = simulation.now;
+            p_drive->motor_ready_time = simulation.now +
+                                        p_model->spin_up_time;
+            simulation.result.spin_ups += 1;
+        }
+        status = 1;
+        break;
+
+    case STATUS_MOTOR:
+        status = !p_drive->motor_on ||
+                 simulation.now < p_drive->motor_ready_time;
+        if (status == 0)
+            p_drive->spinning_up = false;
+        break;
+
+    case READ_DATA:
+    case WRITE_DATA:
+        if (p_drive->busy_command == 0)
+        {
+            /* Once the arm stops, wait for the first sector to come  */
+            /* around, then pass one sector time per sector           */
+            status = 1;
+            if (!p_drive->dma_ready || !p_drive->motor_on ||
+                simulation.now < p_drive->motor_ready_time)
+                break;
+
+            start = simulation.now > p_drive->seek_done ?
+                    simulation.now : p_drive->seek_done;
+            angle = start % (p_model->sector_time *
+                             p_model->sectors_per_track);
+            p_drive->busy_until = start +
+                (p_drive->dma_sector * p_model->sector_time - angle +
+                 p_model->sector_time * p_model->sectors_per_track) %
+                (p_model->sector_time * p_model->sectors_per_track) +
+                p_drive->dma_length / p_model->bytes_per_sector *
+                p_model->sector_time;
+            p_drive->busy_command = operation_code;
+            simulation.result.transfers += 1;
+
+            /* Time the gap since the last transfer ended              */
+            if (p_drive->transfer_end >= 0)
+            {
+                simulation.result.gap_time += start - p_drive->transfer_end;
+                simulation.result.gaps += 1;
+                p_drive->transfer_end = -1;
+            }
+        }
+        else if (p_drive->busy_command != operation_code ||
+                 simulation.now < p_drive->busy_until)
+        {
+            status = 1;
+        }
+        else
+        {
+            /* Move the data between the platter and memory           */
+            offset = (((long long)p_drive->heads *
+                       p_model->tracks_per_cylinder + p_drive->dma_track) *
+                      p_model->sectors_per_track + p_drive->dma_sector) *
+                     p_model->bytes_per_sector;
+            if (operation_code == READ_DATA)
+                memcpy(p_drive->p_dma_address,
+                       p_drive->p_platter + offset, p_drive->dma_length);
+            else
+                memcpy(p_drive->p_platter + offset,
+                       p_drive->p_dma_address, p_drive->dma_length);
+
+            p_drive->busy_command = 0;
+            p_drive->dma_ready = false;
+            p_drive->transfer_end = p_drive->busy_until;
+        }
+        break;
+
+    case STOP_MOTOR:
+        if (p_drive->motor_on)
+            simulation.result.motor_energy += motor_run_energy(p_drive);
+        p_drive->motor_on = p_drive->spinning_up = false;
+        break;
+
+    case RECALIBRATE:
+        if (p_drive->busy_command == 0)
+        {
+            start = simulation.now > p_drive->seek_done ?
+                    simulation.now : p_drive->seek_done;
+            p_drive->busy_until = start + p_model->seek_settle_time +
+                                  p_drive->heads *
+                                  p_model->seek_cylinder_time;
+            p_drive->busy_command = RECALIBRATE;
+            simulation.result.head_travel += p_drive->heads;
+            simulation.result.recalibrations += 1;
+            status = 1;
+        }
+        else if (p_drive->busy_command != RECALIBRATE ||
+                 simulation.now < p_drive->busy_until)
+        {
+            status = 1;
+        }
+        else
+        {
+            p_drive->heads = 0;
+            p_drive->busy_command = 0;
+        }
+        break;
+
+    default:
+        status = -1;
+    }
+
+    if (status != 0 && (operation_code == STATUS_MOTOR ||
+                        operation_code == READ_DATA ||
+                        operation_code == WRITE_DATA ||
+                        operation_code == RECALIBRATE))
+        simulation.result.busy_polls += 1;
+
+    return status;
+}
+
+/**********************************************************************/
+/*  Take the finished requests off the completion ring and add the    */
+/*                  requests now due to the submission ring           */
+/**********************************************************************/
+void notify_file_system()
+{
+    MESSAGE *p_reply; /* Points to a finished request's reply         */
+    int request;      /* The request a reply is for                   */
+
+    simulation.now += simulation.model.message_time;
+    simulation.result.messages += 1;
+    check_time_limit();
+
+    for (; (p_reply = peek_ring(p_complete_ring)) != NULL;
+         pop_ring(p_complete_ring))
+    {
+        if (p_reply->request_number < 1 ||
+            p_reply->request_number > MAX_REQUEST_NUM ||
+            (request = simulation.request_index[p_reply->request_number])
+            < 0 ||
+            simulation.p_request[request].state != REQUEST_SUBMITTED ||
+            simulation.p_request[request].request_number !=
+                p_reply->request_number)
+            continue;
+
+        complete_request(request, p_reply->operation_code);
+    }
+
+    if (simulation.result.completed == simulation.request_count)
+        finish_simulation();
+
+    submit_requests();
+
+    return;
+}
+
+/**********************************************************************/
+/*             Return the device's clock in microseconds              */
+/**********************************************************************/
+long long disk_clock()
+{
+    return simulation.now;
+}
+
+/**********************************************************************/
+/*  Sleep until a device or the file system signals, or the time is   */
+/*                   up, and return the event or 0                    */
+/**********************************************************************/
+int wait_event(long long wait_time, int *p_device_number)
+{
+    SIM_DRIVE *p_drive;    /* Points to the drive being checked       */
+    long long wake_time = simulation.now + wait_time, /* When to wake */
+        device_time,       /* When the drive signals, or -1           */
+        message_time = -1; /* When the file system signals, or -1     */
+    int event = 0,         /* The event that wakes the driver         */
+        drive;             /* Count the drives                        */
+
+    simulation.result.waits += 1;
+    check_time_limit();
+
+    /* A drive signals when its command ends or its motor comes up to */
+    /* speed, and keeps signalling until the driver polls it.  The    */
+    /* earliest drive wakes the driver                                */
+    for (drive = 0; drive < simulation.drives; drive++)
+    {
+        p_drive = &simulation.drive[drive];
+        device_time = -1;
+        if (p_drive->busy_command != 0)
+            device_time = p_drive->busy_until;
+        else if (p_drive->spinning_up)
+            device_time = p_drive->motor_ready_time;
+        else
+            p_drive->transfer_end = -1;
+
+        if (device_time >= 0 && device_time <= wake_time &&
+            (event == 0 || device_time < wake_time))
+        {
+            wake_time = device_time;
+            event = DEVICE_EVENT;
+            *p_device_number = drive;
+        }
+    }
+
+    /* The file system signals once it has put a request that has     */
+    /* fallen due into the submission ring, it cannot while the ring  */
+    /* is full                                                        */
+    if (simulation.next_arrival < simulation.request_count)
+    {
+        message_time =
+            simulation.p_workload[simulation.next_arrival].arrival_time;
+        if (message_time < simulation.now)
+            message_time = simulation.now;
+    }
+
+    if (message_time >= 0 && message_time < wake_time)
+    {
+        simulation.now = message_time;
+        if (submit_requests() > 0)
+            return MESSAGE_EVENT;
+    }
+    if (wake_time > simulation.now)
+        simulation.now = wake_time;
+
+    return event;
+}
+
+/**********************************************************************/
+/*           Allocate zeroed memory or abort the simulation           */
+/**********************************************************************/
+void *sim_allocate(size_t size)
+{
+    void *p_memory; /* Points to the new memory                       */
+
+    if ((p_memory = calloc(1, size)) == NULL)
+    {
+        printf("\nError #%d occurred in sim_allocate.", SIM_ALLOC_ERR);
+        printf("\nUnable to allocate memory for the simulation.");
+        printf("\nThe program is aborting.");
+        exit(SIM_ALLOC_ERR);
+    }
+
+    return p_memory;
+}
+
+/**********************************************************************/
+/*          Return the platter offset of a block's first byte         */
+/**********************************************************************/
+long long block_offset(int block_number)
+{
+    DISK_MODEL *p_model = &simulation.model; /* The disk model        */
+
+    return ((long long)(block_number - 1) / simulation.blocks_per_cylinder *
+                p_model->tracks_per_cylinder * p_model->sectors_per_track +
+            (block_number - 1) % simulation.blocks_per_cylinder *
+                p_model->sectors_per_block) *
+           p_model->bytes_per_sector;
+}
+
+/**********************************************************************/
+/*  Return where a scripted request's block sits in the block tables  */
+/**********************************************************************/
+int block_index(WORKLOAD_REQUEST *p_script)
+{
+    return p_script->device_number * (simulation.block_count + 1) +
+           p_script->block_number;
+}
+
+/**********************************************************************/
+/*            Abandon a run that has gone on far too long             */
+/**********************************************************************/
+void check_time_limit()
+{
+    if (simulation.now > SIM_TIME_LIMIT)
+    {
+        simulation.result.timed_out = 1;
+        finish_simulation();
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*  Add the requests now due to the submission ring, returning how    */
+/*                          many went in                              */
+/**********************************************************************/
+int submit_requests()
+{
+    RING_SLOT *p_slot;     /* Points to the slot a request goes in    */
+    int count_request = 0; /* Count the requests submitted            */
+
+    while (simulation.next_arrival < simulation.request_count &&
+           simulation.p_workload[simulation.next_arrival].arrival_time <=
+               simulation.now)
+    {
+        if ((p_slot = claim_ring_slot(p_submit_ring)) == NULL)
+        {
+            simulation.result.refused += 1;
+            break;
+        }
+        deliver_request(simulation.next_arrival++, &p_slot->message);
+        publish_ring_slot(p_slot);
+        count_request++;
+    }
+
+    return count_request;
+}
+
+/**********************************************************************/
+/*        Fill in a submission ring message for a request             */
+/**********************************************************************/
+void deliver_request(int request, MESSAGE *p_message)
+{
+    WORKLOAD_REQUEST *p_script = &simulation.p_workload[request];
+                                 /* The scripted request               */
+    SIM_REQUEST *p_request = &simulation.p_request[request];
+                                 /* The request's state                */
+    BLOCK_TAG tag;               /* The tag a write puts on the block  */
+
+    /* Number and tag the request the first time it is submitted      */
+    if (p_request->state == REQUEST_WAITING)
+    {
+        p_request->state = REQUEST_SUBMITTED;
+        p_request->request_number = simulation.next_request_number;
+        simulation.request_index[p_request->request_number] = request;
+        if (++simulation.next_request_number > MAX_REQUEST_NUM)
+            simulation.next_request_number = 1;
+
+        if (p_script->operation_code == WRITE_OPERATION)
+        {
+            tag.block_number = p_script->block_number;
+            tag.version = p_request->version = ++simulation.write_count;
+            memcpy(p_request->p_buffer, &tag, sizeof(tag));
+            simulation.p_block_latest[block_index(p_script)] = tag.version;
+            simulation.p_block_epoch[block_index(p_script)] += 1;
+        }
+        else if (p_script->operation_code != SYNC_DEVICE)
+        {
+            /* A read must get the newest write submitted before it,  */
+            /* whether from the disk, the cache, or a queued write    */
+            memset(p_request->p_buffer, 0, sizeof(tag));
+            p_request->version =
+                simulation.p_block_latest[block_index(p_script)];
+            p_request->write_epoch =
+                simulation.p_block_epoch[block_index(p_script)];
+            p_request->write_failures = simulation.write_failures;
+        }
+    }
+
+    p_message->operation_code = p_script->operation_code;
+    p_message->request_number = p_request->request_number;
+    p_message->block_number = p_script->block_number;
+    p_message->device_number = p_script->device_number;
+    p_message->priority = PRIORITY_NORMAL;
+    p_message->deadline_time = 0;
+    if (simulation.send_classes)
+    {
+        p_message->priority = p_script->priority;
+        p_message->deadline_time = p_script->deadline_time;
+    }
+    p_message->block_size =
+        simulation.model.sectors_per_block * simulation.model.bytes_per_sector;
+    p_message->p_data_address = p_request->p_buffer;
+
+    return;
+}
+
+/**********************************************************************/
+/*             Record a request the driver has completed              */
+/**********************************************************************/
+void complete_request(int request, int error_code)
+{
+    WORKLOAD_REQUEST *p_script = &simulation.p_workload[request];
+                                 /* The scripted request               */
+    SIM_REQUEST *p_request = &simulation.p_request[request];
+                                 /* The request's state                */
+    BLOCK_TAG tag;               /* The tag the read brought back      */
+
+    p_request->state = REQUEST_DONE;
+    simulation.request_index[p_request->request_number] = -1;
+    simulation.p_latency[simulation.result.completed] =
+        simulation.now - p_script->arrival_time;
+    simulation.result.total_latency +=
+        simulation.now - p_script->arrival_time;
+    simulation.result.completed += 1;
+    simulation.result.class_latency[p_script->priority] +=
+        simulation.now - p_script->arrival_time;
+    simulation.result.class_completed[p_script->priority] += 1;
+    if (p_script->deadline_time > 0 &&
+        simulation.now - p_script->arrival_time > p_script->deadline_time)
+        simulation.result.deadline_misses += 1;
+
+    if (error_code != 0)
+        simulation.result.failed += 1;
+
+    /* A read may get a write submitted after it, but nothing older   */
+    /* than the newest one submitted before it, and exactly that one  */
+    /* if no write followed.  Once a write has failed the disk may    */
+    /* hold older data, so only the block number is checked.          */
+    if (p_script->operation_code == WRITE_OPERATION)
+    {
+        if (error_code != 0)
+            simulation.write_failures += 1;
+    }
+    else if (p_script->operation_code != SYNC_DEVICE && error_code == 0)
+    {
+        memcpy(&tag, p_request->p_buffer, sizeof(tag));
+        if (tag.block_number != p_script->block_number ||
+            (p_request->write_failures == simulation.write_failures &&
+             (tag.version < p_request->version ||
+              (p_request->write_epoch ==
+                   simulation.p_block_epoch[block_index(p_script)] &&
+               tag.version != p_request->version))))
+            simulation.result.data_errors += 1;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*            Report the results of the run and end the process       */
+/**********************************************************************/
+void finish_simulation()
+{
+    SIM_RESULT *p_result = &simulation.result; /* The run's results   */
+    int drive;                                 /* Count the drives    */
+
+    /* Collect how well the driver's read ahead did, the disk work    */
+    /* its queues saved, and what the motors still running have used  */
+    for (drive = 0; drive < simulation.drives; drive++)
+    {
+        p_result->saved_operations += device[drive].p_queue->merged_reads +
+                                      device[drive].p_queue->forwarded_reads +
+                                      device[drive].p_queue->superseded_writes;
+        if (simulation.drive[drive].motor_on)
+            p_result->motor_energy +=
+                motor_run_energy(&simulation.drive[drive]);
+        if (device[drive].p_cache != NULL)
+        {
+            p_result->read_ahead_hits +=
+                device[drive].p_cache->read_ahead_hits;
+            p_result->read_ahead_waste +=
+                device[drive].p_cache->read_ahead_waste;
+        }
+    }
+
+    p_result->elapsed_time = simulation.now;
+    if (p_result->completed > 0)
+    {
+        qsort(simulation.p_latency, p_result->completed, sizeof(long long),
+              compare_latency);
+        p_result->p99_latency =
+            simulation.p_latency[(p_result->completed * 99 - 1) / 100];
+    }
+
+    if (simulation.result_file >= 0)
+    {
+        /* A bench child leaves without running the exit handlers     */
+        if (driver_options.p_stats_path != NULL)
+            dump_statistics();
+        close_trace();
+        if (write(simulation.result_file, p_result, sizeof(SIM_RESULT)) !=
+            sizeof(SIM_RESULT))
+            _exit(1);
+        _exit(0);
+    }
+
+    printf("\n%d requests in %.3f s, %d failed, %d data errors%s\n",
+           p_result->completed, p_result->elapsed_time / 1e6,
+           p_result->failed, p_result->data_errors,
+           p_result->timed_out ? ", timed out" : "");
+    exit(0);
+}
+
+/**********************************************************************/
+/*                  Order two latencies for sorting                   */
+/**********************************************************************/
+int compare_latency(const void *p_first, const void *p_second)
+{
+    long long first = *(const long long *)p_first,   /* First latency  */
+        second = *(const long long *)p_second;       /* Second latency */
+
+    return (first > second) - (first < second);
+}
+
+/**********************************************************************/
+/*  Return the energy a running motor has used since it was started   */
+/**********************************************************************/
+long long motor_run_energy(SIM_DRIVE *p_drive)
+{
+    long long run_time = simulation.now - p_drive->motor_start_time,
+                         /* How long the motor has run                */
+        spin_up_time = simulation.model.spin_up_time;
+                         /* How much of it was spent spinning up      */
+
+    if (spin_up_time > run_time)
+        spin_up_time = run_time;
+
+    return spin_up_time * simulation.model.spin_up_power +
+           (run_time - spin_up_time) * simulation.model.motor_power;
+}
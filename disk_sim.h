@@ -0,0 +1,125 @@
+/**********************************************************************/
+/*                                                                    */
+/* Header Name:  disk_sim.h - Simulated disk device and file system   */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This header declares the host side stand-ins for the disk device   */
+/* and the file system: a disk model with timings, a scripted         */
+/* workload for the file system to feed the driver, and the results   */
+/* gathered while the driver runs against them.                       */
+/*                                                                    */
+/**********************************************************************/
+
+#ifndef DISK_SIM_H
+#define DISK_SIM_H
+
+#include "driver.h"
+
+/**********************************************************************/
+/*                         Symbolic Constants                         */
+/**********************************************************************/
+#define SIM_ALLOC_ERR 5         /* Simulation memory allocation error */
+#define MAX_REQUEST_NUM 32767   /* Largest request number the file    */
+                                /* system gives before starting over  */
+#define SIM_TIME_LIMIT 100000000000LL /* Simulated microseconds before */
+                                      /* a run is abandoned            */
+
+/**********************************************************************/
+/*                         Program Structures                         */
+/**********************************************************************/
+/* The simulated disk's geometry and timings, times in microseconds   */
+struct disk_model
+{
+    int cylinders,                /* Cylinders in the disk             */
+        tracks_per_cylinder,      /* Tracks in a cylinder              */
+        sectors_per_track,        /* Sectors in a track                */
+        sectors_per_block,        /* Sectors in a block                */
+        bytes_per_sector,         /* Bytes in a sector                 */
+        seek_error_interval,      /* One seek in this many lands on    */
+                                  /* the wrong cylinder, 0 for never   */
+        motor_power,              /* Milliwatts a running motor draws  */
+        spin_up_power;            /* Milliwatts a motor draws while    */
+                                  /* spinning up                       */
+    long long seek_settle_time,   /* Fixed cost of any seek            */
+        seek_cylinder_time,       /* Seek cost per cylinder crossed    */
+        sector_time,              /* Time for one sector to pass the   */
+                                  /* heads, sets rotation and transfer */
+                                  /* rate                              */
+        spin_up_time,             /* Motor start to full speed         */
+        command_time,             /* Cost of every device command      */
+        message_time;             /* Cost of every file system message */
+};
+typedef struct disk_model DISK_MODEL;
+
+/* One request in the file system's script                            */
+struct workload_request
+{
+    long long arrival_time; /* When the file system submits it         */
+    int operation_code,     /* 1 to read or 2 to write                 */
+        device_number,      /* The drive holding the block             */
+        block_number,       /* The block to read or write              */
+        priority;           /* The request's priority class            */
+    long long deadline_time; /* Time from arrival it must be done in,  */
+                            /* 0 for no deadline                       */
+};
+typedef struct workload_request WORKLOAD_REQUEST;
+
+/* What one run of the driver against the simulation did              */
+struct sim_result
+{
+    int completed,           /* Requests completed                     */
+        failed,              /* Completed with an error code           */
+        refused,             /* Times a request fell due with the      */
+                             /* submission ring full                   */
+        data_errors,         /* Reads that returned the wrong data     */
+        timed_out,           /* The run hit SIM_TIME_LIMIT             */
+        class_completed[PRIORITY_CLASSES],
+                             /* Requests completed in each class       */
+        deadline_misses;     /* Completed after their deadlines        */
+    long long elapsed_time,  /* Simulated time for the whole run       */
+        total_latency,       /* Sum of submit to completion times      */
+        class_latency[PRIORITY_CLASSES],
+                             /* Sum of each class's latencies          */
+        p99_latency,         /* 99th percentile latency                */
+        head_travel,         /* Cylinders the heads moved across       */
+        seeks,               /* Seeks that moved the heads             */
+        recalibrations,      /* Recalibrations after a bad seek        */
+        spin_ups,            /* Motor starts                           */
+        motor_energy,        /* Energy the motors used in nanojoules   */
+        transfers,           /* Read and write transfers               */
+        commands,            /* Device commands issued                 */
+        busy_polls,          /* Commands answered with busy            */
+        messages,            /* Messages sent to the file system       */
+        waits,               /* Times the driver slept for an event    */
+        gap_time,            /* Time between back to back transfers,   */
+                             /* leaving out the seeks                  */
+        gaps,                /* Back to back transfers                 */
+        read_ahead_hits,     /* Reads served from blocks read ahead    */
+        read_ahead_waste,    /* Blocks read ahead but never read       */
+        saved_operations;    /* Reads and writes the driver's queue    */
+                             /* kept off the disk for another request  */
+                             /* of the same block                      */
+};
+typedef struct sim_result SIM_RESULT;
+
+extern DISK_MODEL default_disk_model; /* A double density floppy     */
+
+/**********************************************************************/
+/*                        Function Prototypes                         */
+/**********************************************************************/
+void start_simulation(DISK_MODEL *p_model, int drives,
+                      WORKLOAD_REQUEST *p_workload, int request_count,
+                      bool send_classes, int result_file);
+/* Load the disk model, the drives, and the file system's script for  */
+/* one run, telling the driver the script's priority classes and      */
+/* deadlines or leaving every request an ordinary one                 */
+unsigned int sim_random(unsigned long long *p_seed);
+/* Return the next number from a repeatable random sequence           */
+
+#endif
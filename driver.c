@@ -23,439 +23,987 @@
 
 /**********************************************************************/
 /*                                                                    */
-/* This program creates a file system request list and a pending      */
-/* request list, puts read/write requests from file system to pending */
-/* request list, convert physical block numbers into disk drive       */
-/* cylinder, track, and sector numbers, then tell the disk device to  */
-/* process read/write requests.                                       */
+/* This program takes read/write requests from the file system's      */
+/* submission ring into a pending request list, convert physical      */
+/* block numbers into disk drive cylinder, track, and sector numbers, */
+/* then tell the disk device to process read/write requests, and      */
+/* posts the finished requests to the completion ring.                */
 /*                                                                    */
 /**********************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "driver.h"
 
 /**********************************************************************/
-/*                         Symbolic Constants                         */
-/**********************************************************************/
-#define CYLINDERS_PER_DISK 40   /* Number of cylinders in a disk      */
-#define TRACKS_PER_CYLINDER 2   /* Number of tracks in a cylinder     */
-#define SECTORS_PER_TRACK 9     /* Number of sectors in a track       */
-#define BYTES_PER_SECTOR 512    /* Number of bytes in a sector        */
-#define SECTORS_PER_BLOCK 2     /* Number of sectors in a block       */
-#define LIST_HEADER 0           /* Linked list header value           */
-#define LIST_TRAILER 361        /* Linked list trailer value          */
-#define HEADER_ALLOC_ERR 1      /* Header memory allocation error     */
-#define TRAILER_ALLOC_ERR 2     /* Trailer memory allocation error    */
-#define REQUEST_ALLOC_ERR 3     /* Request memory allocation error    */
-#define MAX_REQUEST_NUM 32767   /* Maximum request number allowed     */
-#define MAX_IDLE_REQUESTS 2     /* Maximum idle requests allowed      */
-#define SENSE_CYLINDER 1        /* Sense cylinder code number         */
-#define SEEK_TO_CYLINDER 2      /* Seek to cylinder code number       */
-#define DMA_SETUP 3             /* DMA setup code number              */
-#define START_MOTOR 4           /* Start motor code number            */
-#define STATUS_MOTOR 5          /* Status motor code number           */
-#define READ_DATA 6             /* Read data code number              */
-#define WRITE_DATA 7            /* Write data code number             */
-#define STOP_MOTOR 8            /* Stop motor code number             */
-#define RECALIBRATE 9           /* Recalibrate code number            */
-#define MAX_PENDING_REQUESTS 20 /* Maximum pending requests allowed   */
-
-/**********************************************************************/
-/*                         Program Structures                         */
-/**********************************************************************/
-/* A file system request list entry                                   */
-struct message
-{
-    int operation_code;                /* The disk operation to be    */
-                                       /* performed                   */
-    int request_number;                /* A unique request number     */
-    int block_number;                  /* The block number to be read */
-                                       /* or written                  */
-    int block_size;                    /* The block size in bytes     */
-    unsigned long int *p_data_address; /* Points to the data block in */
-                                       /* memory                      */
-};
-typedef struct message MESSAGE;
-MESSAGE fs_message[MAX_PENDING_REQUESTS]; /* File system request list  */
-
-/* A pending request list entry                                        */
-struct request
-{
-    int block_number,                  /* The block number to be read  */
-                                       /* or written                   */
-        block_size,                    /* The block size in bytes      */
-        operation_code,                /* The disk operation to be     */
-                                       /* performed                    */
-        request_number;                /* A unique request number      */
-    unsigned long int *p_data_address; /* Points to the data block in  */
-                                       /* memory                       */
-    struct request *p_next_request;    /* Points to the next request   */
-};
-typedef struct request REQUEST;
-REQUEST *p_pending_request_list; /* Points to the pending request     */
-                                 /* list                              */
-
-/**********************************************************************/
-/*                        Function Prototypes                         */
-/**********************************************************************/
-void convert_block(int block, int *p_cylinder, int *p_sector, int *p_track);
-/* Convert physical block numbers into disk drive cylinder, track,    */
-/* and sector numbers                                                 */
-REQUEST *create_list();
-/* Create an empty pending request list with header and trailer       */
-REQUEST *create_pending_request(MESSAGE fs_message);
-/* Create a new pending request and return its address                */
-void add_pending_request(REQUEST *p_pending_request_list,
-                         REQUEST *p_new_request);
-/* Add a new pending request and put it in order by block number      */
-void remove_pending_request(REQUEST *p_current_request,
-                            REQUEST *p_pending_request_list);
-/* Remove the given request from the pending request list             */
-void set_idle_message(MESSAGE *fs_message);
-/* Check for any invalid parameters and return the error code         */
-int get_error_code(REQUEST *p_current_request);
-/* Set an idle message                                                */
+/*                          Global Variables                          */
+/**********************************************************************/
+DEVICE device[MAX_DEVICES];               /* The disk devices, by      */
+                                          /* device number             */
+OPTIONS driver_options = {DEFAULT_POOL_REQUESTS, CIRCULAR_LOOK,
+                          DEFAULT_EXPIRE_DISPATCHES, 0, 1, 0, 1, 0, 0,
+                          DEFAULT_FLUSH_TIME, 0, NULL, NULL};
+                                          /* The driver's runtime      */
+                                          /* settings                  */
+GEOMETRY disk_geometry = {DEFAULT_CYLINDERS, DEFAULT_TRACKS,
+                          DEFAULT_SECTORS, DEFAULT_SECTORS_PER_BLOCK,
+                          0, 0, 0};
+                                          /* The geometry of every     */
+                                          /* disk device               */
+BLOCK_ADDRESS *p_block_address;           /* Every block's address,    */
+                                          /* built by load_geometry    */
 
 /**********************************************************************/
 /*                           Main Function                            */
 /**********************************************************************/
-int main()
+#ifndef NO_DRIVER_MAIN
+int main(int argc, char *argv[])
 {
-    REQUEST *p_current_request;  /* Points to the current request     */
-    bool disk_on = false;        /* Disk drive status                 */
-    int error_code = 0,          /* Error code number                 */
-        count_fs_message = 0,    /* Count file system request         */
-                                 /* list entries                      */
-        count_idle = 0,          /* Count idle requests               */
-        disk_heads,              /* Current disk heads' position      */
-                                 /* in cylinder number                */
-        cylinder,                /* Cylinder number                   */
-        last_request_number = 0, /* Last request number from the      */
-                                 /* file system                       */
-        sector,                  /* Sector number                     */
-        track,                   /* Track number                      */
-        value_sign = 1;          /* Multiplier to change sign         */
-
-    /* Create empty pending request list                              */
-    p_pending_request_list = create_list();
-
-    /* Loop processing the driver, never stops                        */
-    while (true)
+    /* Read the runtime settings and the disk geometry, then run the  */
+    /* driver for good                                                */
+    parse_options(argc, argv);
+    run_driver();
+
+    return 0;
+}
+#endif
+
+/**********************************************************************/
+/*     Run the driver, moving requests between the file system and    */
+/*                          the disk devices                          */
+/**********************************************************************/
+void run_driver()
+{
+    DEVICE *p_device;            /* Points to the device being served */
+    MESSAGE *p_message,          /* Points to a submitted request     */
+        reply_message;           /* Reports a finished request        */
+    REQUEST *p_current_request,  /* Points to the current request     */
+        *p_new_request;          /* Points to a new request           */
+    bool intake_blocked,         /* A request is waiting for a node   */
+         device_ready;           /* A device is free and has work     */
+    long long wait_time,         /* Longest to sleep for an event     */
+        spin_down;               /* When an idle motor is stopped     */
+    int count_reply,             /* Count finished requests reported  */
+        count_rejected,          /* Count invalid messages failed     */
+        device_number,           /* Count the devices                 */
+        error_code,              /* A message's error code            */
+        event;                   /* The event that woke the driver    */
+
+    start_statistics();
+    start_trace();
+    p_submit_ring = create_ring(RING_ENTRIES);
+    p_complete_ring = create_ring(RING_ENTRIES);
+
+    /* Give every device an empty pending request queue of its own    */
+    for (device_number = 0; device_number < driver_options.devices;
+         device_number++)
     {
-        /* Loop processing file system messages                       */
-        while (fs_message[count_fs_message].operation_code != 0 &&
-               count_fs_message < MAX_PENDING_REQUESTS)
+        p_device = &device[device_number];
+        p_device->device_number = device_number;
+        p_device->state = DEVICE_IDLE;
+        p_device->idle_start = 0;
+        p_device->idle_average = 0;
+        p_device->disk_on = p_device->signalled = false;
+        p_device->message_held = false;
+        p_device->p_queue = create_list(driver_options.pool_requests,
+                                        disk_geometry.cylinders);
+        p_device->p_cache = NULL;
+        if (driver_options.cache_kbytes > 0)
+            p_device->p_cache = create_cache(
+                (driver_options.cache_kbytes * 1024 +
+                 disk_geometry.bytes_per_block - 1) /
+                disk_geometry.bytes_per_block);
+        p_device->scheduler.policy = driver_options.policy;
+        p_device->scheduler.direction = 1;
+        p_device->scheduler.transfer_time = 0;
+        p_device->scheduler.deadline_dispatches = 0;
+        p_device->scheduler.expire_dispatches =
+            driver_options.expire_dispatches;
+        p_device->p_transfer = &p_device->transfer[0];
+        p_device->p_lookahead = &p_device->transfer[1];
+        p_device->transfer[0].block_count =
+            p_device->transfer[1].block_count = 0;
+        if ((p_device->transfer[0].p_buffer = (unsigned long int *)malloc(
+                 disk_geometry.blocks_per_cylinder *
+                 disk_geometry.bytes_per_block)) == NULL ||
+            (p_device->transfer[1].p_buffer = (unsigned long int *)malloc(
+                 disk_geometry.blocks_per_cylinder *
+                 disk_geometry.bytes_per_block)) == NULL)
         {
-            /* Set last request number to zero everytime it reaches   */
-            /* maximum request number                                 */
-            if (last_request_number == MAX_REQUEST_NUM)
-                last_request_number = 0;
-
-            /* Add a request into pending request list                */
-            if (fs_message[count_fs_message].request_number > last_request_number ||
-                fs_message[count_fs_message].request_number <= 0)
+            printf("\nError #%d occurred in run_driver.", GEOMETRY_ALLOC_ERR);
+            printf("\nUnable to allocate memory for the transfer buffers.");
+            printf("\nThe program is aborting.");
+            exit(GEOMETRY_ALLOC_ERR);
+        }
+    }
+
+    /* Loop processing the driver until a signal asks it to stop      */
+    while (!poll_statistics())
+    {
+        /* Queue each message a device held for want of a node, now   */
+        /* that a node is free                                        */
+        for (device_number = 0; device_number < driver_options.devices;
+             device_number++)
+        {
+            p_device = &device[device_number];
+            if (p_device->message_held &&
+                p_device->p_queue->p_free_request != NULL)
             {
-                add_pending_request(p_pending_request_list,
-                                    create_pending_request(fs_message[count_fs_message]));
-
-                if (fs_message[count_fs_message].request_number != 0)
-                {
-                    last_request_number =
-                        fs_message[count_fs_message].request_number;
-                }
+                p_device->message_held = false;
+                accept_request(p_device, create_pending_request(
+                                             p_device->p_queue,
+                                             p_device->held_message));
             }
-
-            count_fs_message++;
         }
-        count_fs_message = 0;
 
-        /* Check if pending request list have any request to process  */
-        if (p_pending_request_list->p_next_request->p_next_request != NULL)
+        /* Take the submitted requests in order.  An invalid message  */
+        /* is failed straight back without taking a node.  When a     */
+        /* device's pool runs dry, it holds the message on its own    */
+        /* and the other devices' messages carry on, and only a       */
+        /* second message for that device is left in the ring, so the */
+        /* file system is held back until nodes are free again and a  */
+        /* device's requests still queue in order.  The ring hands    */
+        /* over each message once, and producers' request numbers     */
+        /* interleave, so no request is dropped for its number        */
+        /* looking stale or repeated                                  */
+        count_rejected = 0;
+        while ((p_message = peek_ring(p_submit_ring)) != NULL)
         {
-            /* Turn the disk drive motor on if it is off              */
-            count_idle = 0;
-            if (disk_on == false)
+            if ((error_code = get_error_code(p_message)) != 0)
             {
-                disk_on = disk_drive(START_MOTOR, 0, 0, 0, 0);
-
-                /* Loop with empty body, wait until the disk motor is */
-                /* up to speed                                        */
-                while (disk_drive(STATUS_MOTOR, 0, 0, 0, 0) != 0)
-                    ;
-
-                /* Sense and set the disk heads current cylinder position */
-                disk_heads = disk_drive(SENSE_CYLINDER, 0, 0, 0, 0);
+                if (!reject_message(p_message, error_code))
+                    break;
+                trace_message(p_message);
+                pop_ring(p_submit_ring);
+                count_rejected++;
+                continue;
             }
 
-            /* Choose the next request to process using a disk arm    */
-            /* elevator scheduling algorithm                          */
-            p_current_request = p_pending_request_list->p_next_request;
-            while (convert_block(p_current_request->block_number, &cylinder,
-                                 &sector, &track),
-                   (disk_heads * value_sign) >
-                       (cylinder * value_sign))
+            p_device = &device[p_message->device_number];
+            if (p_device->message_held)
+                break;
+            if ((p_new_request = create_pending_request(p_device->p_queue,
+                                                        *p_message)) == NULL)
             {
-                if (p_current_request->p_next_request->p_next_request == NULL)
-                {
-                    value_sign = value_sign * -1;
-                    p_current_request = p_pending_request_list->p_next_request;
-                }
-                else
-                {
-                    p_current_request = p_current_request->p_next_request;
-                }
+                p_device->held_message = *p_message;
+                p_device->message_held = true;
+                trace_message(p_message);
+                pop_ring(p_submit_ring);
+                continue;
             }
+            trace_message(p_message);
+            pop_ring(p_submit_ring);
+            accept_request(p_device, p_new_request);
+        }
+        if (count_rejected > 0)
+            notify_file_system();
+
+        intake_blocked = false;
+        for (device_number = 0; device_number < driver_options.devices;
+             device_number++)
+            if (device[device_number].message_held)
+                intake_blocked = true;
+
+        /* Move each device on once it has signalled, and start it on */
+        /* its next request whenever it is free, so every device      */
+        /* works at the same time                                     */
+        device_ready = false;
+        for (device_number = 0; device_number < driver_options.devices;
+             device_number++)
+        {
+            p_device = &device[device_number];
+            if (p_device->idle_start >= 0 &&
+                p_device->p_queue->request_count > 0)
+                end_idle_time(p_device);
+            if (p_device->signalled || p_device->state == DEVICE_IDLE)
+                poll_device(p_device);
+            p_device->signalled = false;
+
+            /* Plan the next transfer while the device is busy with   */
+            /* this one, so it can start the moment this one ends     */
+            if (driver_options.lookahead &&
+                p_device->state == DEVICE_TRANSFERRING &&
+                p_device->p_lookahead->block_count == 0)
+                plan_transfer(p_device, p_device->p_lookahead);
+
+            if (p_device->state != DEVICE_IDLE)
+                continue;
+            if (p_device->p_queue->request_count > 0 ||
+                p_device->p_lookahead->block_count > 0)
+                device_ready = true;
+            else if (p_device->idle_start < 0)
+                p_device->idle_start = disk_clock();
+        }
 
-            /* Change the multiplier to positive                      */
-            if (value_sign == -1)
-                value_sign = 1;
-
-            /* Get and set the error code                             */
-            error_code = get_error_code(p_current_request);
-
-            /* Process the request if there is no errors              */
-            if (error_code == 0)
+        /* Post a batch of finished requests, oldest first, once the  */
+        /* batch is due, leaving the rest for later if the completion */
+        /* ring fills                                                 */
+        if (batch_is_due(intake_blocked))
+        {
+            for (count_reply = 0;
+                 count_reply < driver_options.batch_size &&
+                 (p_device = find_oldest_finished()) != NULL;
+                 count_reply++)
             {
-                /* Check if the request to process is in another cylinder */
-                if (disk_heads != cylinder)
-                {
-                    /* Send the disk heads to the given cylinder      */
-                    disk_heads = disk_drive(SEEK_TO_CYLINDER, 
-                                                     cylinder, 0, 0, 0);
-
-                    /* Check if the disk heads land correctly         */
-                    while (disk_heads != cylinder)
-                    {
-                        /* Loop with empty body, wait until the disk  */
-                        /* heads land on cylinder zero                */
-                        while (disk_drive(RECALIBRATE, 0, 0, 0, 0) != 0)
-                            ;
-
-                        disk_heads = 0;
-
-                        if (cylinder != 0)
-                        {
-                            disk_heads =
-                                disk_drive(SEEK_TO_CYLINDER, 
-                                                    cylinder, 0, 0, 0);
-                        }
-                    }
-                }
-
-                /* Process the request if DMA sets up correctly       */
-                if (disk_drive(DMA_SETUP, sector, track, 
-                               BYTES_PER_SECTOR * SECTORS_PER_BLOCK, 
-                               p_current_request->p_data_address) == 0)
-                {
-                    /* Read or write the request                      */
-                    if (p_current_request->operation_code == 1)
-                    {
-                        while (disk_drive(READ_DATA, 0, 0, 0, 0) != 0)
-                            ;
-
-                        fs_message[0].operation_code = 0;
-                    }
-                    else
-                    {
-                        while (disk_drive(WRITE_DATA, 0, 0, 0, 0) != 0)
-                            ;
-
-                        fs_message[0].operation_code = 0;
-                    }
-                }
+                set_reply_message(&reply_message,
+                                  p_device->p_queue->p_first_finished);
+                if (!push_ring(p_complete_ring, &reply_message))
+                    break;
+                p_current_request = take_finished_request(p_device->p_queue);
+                record_request(&p_device->statistics, p_current_request);
+                free_pending_request(p_current_request, p_device->p_queue);
             }
-            else
+            if (count_reply > 0)
             {
-                /* Set the error code to be send to the file system   */
-                fs_message[0].operation_code = error_code;
-                error_code = 0;
+                notify_file_system();
+                continue;
             }
-
-            /* Set a message and send it to the file system           */
-            fs_message[0].request_number = p_current_request->request_number;
-            fs_message[0].p_data_address = p_current_request->p_data_address;
-            fs_message[0].block_number = p_current_request->block_number;
-            fs_message[0].block_size = p_current_request->block_size;
-            send_message(fs_message);
-
-            /* Remove the request from the pending request list       */
-            remove_pending_request(p_current_request, p_pending_request_list);
         }
-        else
+
+        /* Go straight on while a device is free and has work         */
+        if (device_ready)
+            continue;
+
+        /* Sleep until a device finishes, the file system has         */
+        /* requests, or the oldest finished request's batch falls due */
+        wait_time = IDLE_WAIT_TIME;
+        if ((p_device = find_oldest_finished()) != NULL &&
+            p_device->p_queue->p_first_finished->finish_time +
+                driver_options.flush_time - disk_clock() < wait_time)
+            wait_time = p_device->p_queue->p_first_finished->finish_time +
+                        driver_options.flush_time - disk_clock();
+
+        /* Turn a disk drive motor off once its device has been idle  */
+        /* long enough, and wake up in time to turn off the rest      */
+        for (device_number = 0; device_number < driver_options.devices;
+             device_number++)
         {
-            /* Turn the disk drive motor off after receiving two idle */
-            /* request in a row from the file system                  */
-            count_idle += 1;
-            if (count_idle >= MAX_IDLE_REQUESTS && disk_on)
-            {
-                disk_drive(STOP_MOTOR, 0, 0, 0, 0);
-                disk_on = false;
-            }
+            p_device = &device[device_number];
+            if (!p_device->disk_on || p_device->idle_start < 0)
+                continue;
+            spin_down = spin_down_time(p_device);
+            if (spin_down <= disk_clock())
+                stop_motor(p_device);
+            else if (spin_down - disk_clock() < wait_time)
+                wait_time = spin_down - disk_clock();
+        }
+        event = wait_event(wait_time, &device_number);
 
-            /* Set an idle message and send it to the file system     */
-            set_idle_message(&fs_message[0]);
-            send_message(fs_message);
+        /* New requests are already waiting in the submission ring    */
+        /* after a message event                                      */
+        if (event == DEVICE_EVENT)
+            device[device_number].signalled = true;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*            Read the runtime settings from the command line         */
+/**********************************************************************/
+void parse_options(int argc, char *argv[])
+{
+    int option; /* The option letter being processed                  */
+
+    while ((option = getopt(argc, argv, "n:s:e:m:b:l:d:g:k:r:t:i:o:x:")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            driver_options.pool_requests = parse_number(optarg, INT_MAX);
+            break;
+        case 's':
+            driver_options.policy = find_policy(optarg);
+            break;
+        case 'e':
+            driver_options.expire_dispatches = parse_number(optarg, INT_MAX);
+            break;
+        case 'm':
+            driver_options.merge_blocks = parse_number(optarg, INT_MAX);
+            break;
+        case 'b':
+            driver_options.batch_size = parse_number(optarg, INT_MAX);
+            break;
+        case 'l':
+            driver_options.lookahead = parse_number(optarg, INT_MAX);
+            break;
+        case 'd':
+            driver_options.devices = parse_number(optarg, INT_MAX);
+            break;
+        case 'g':
+            if (!parse_geometry(optarg, &disk_geometry))
+                driver_options.pool_requests = 0;
+            break;
+        case 'k':
+            driver_options.cache_kbytes = parse_number(optarg, INT_MAX);
+            break;
+        case 'r':
+            driver_options.read_ahead = parse_number(optarg, INT_MAX);
+            break;
+        case 't':
+            driver_options.flush_time = parse_number(optarg, LLONG_MAX);
+            break;
+        case 'i':
+            driver_options.spin_down_time = parse_number(optarg, LLONG_MAX);
+            break;
+        case 'o':
+            driver_options.p_stats_path = optarg;
+            break;
+        case 'x':
+            driver_options.p_trace_path = optarg;
+            break;
+        default:
+            driver_options.pool_requests = 0;
         }
     }
 
-    return 0;
+    /* Size the disk before checking merges against its cylinders     */
+    load_geometry();
+    if (driver_options.pool_requests < 1 || driver_options.policy < 0 ||
+        driver_options.expire_dispatches < 1 ||
+        driver_options.merge_blocks < 0 ||
+        driver_options.merge_blocks > disk_geometry.blocks_per_cylinder ||
+        driver_options.batch_size < 1 ||
+        driver_options.batch_size > MAX_PENDING_REQUESTS ||
+        driver_options.lookahead < 0 || driver_options.lookahead > 1 ||
+        driver_options.devices < 1 ||
+        driver_options.devices > MAX_DEVICES ||
+        driver_options.cache_kbytes < 0 || driver_options.read_ahead < 0 ||
+        driver_options.flush_time < 0 ||
+        driver_options.spin_down_time < 0)
+    {
+        printf("\nError #%d occurred in parse_options.", OPTION_ERR);
+        printf("\nUsage: %s [-n pool_requests] "
+               "[-s scan|cscan|look|clook|sstf|deadline] "
+               "[-e expire_dispatches] [-m merge_blocks] "
+               "[-b batch_size] [-l 0|1] [-d devices] "
+               "[-g cylinders,tracks,sectors,sectors_per_block] "
+               "[-k cache_kbytes] [-r read_ahead] [-t flush_time] "
+               "[-i spin_down_time] [-o stats_file] [-x trace_file]",
+               argv[0]);
+        printf("\nThe program is aborting.");
+        exit(OPTION_ERR);
+    }
+    if (driver_options.merge_blocks == 0)
+        driver_options.merge_blocks = disk_geometry.blocks_per_cylinder;
+
+    return;
 }
 
 /**********************************************************************/
-/*  Convert physical block numbers into disk drive cylinder, track,   */
-/*                         and sector numbers                         */
+/*  Read a cylinders,tracks,sectors,sectors-per-block geometry and    */
+/*          check it, returning false if it is invalid                */
 /**********************************************************************/
-void convert_block(int block, int *p_cylinder, int *p_sector, int *p_track)
+bool parse_geometry(char *p_text, GEOMETRY *p_geometry)
 {
-    *p_cylinder = (int)((block - 1) / SECTORS_PER_TRACK);
+    GEOMETRY geometry; /* The geometry being read                     */
+    char extra;        /* Catches anything after the last number      */
+
+    if (sscanf(p_text, "%d,%d,%d,%d%c", &geometry.cylinders,
+               &geometry.tracks_per_cylinder, &geometry.sectors_per_track,
+               &geometry.sectors_per_block, &extra) != 4 ||
+        geometry.cylinders < 1 || geometry.cylinders > MAX_CYLINDERS ||
+        geometry.tracks_per_cylinder < 1 ||
+        geometry.tracks_per_cylinder > MAX_TRACKS ||
+        geometry.sectors_per_track < 1 ||
+        geometry.sectors_per_track > MAX_SECTORS ||
+        geometry.sectors_per_block < 1 ||
+        (geometry.tracks_per_cylinder * geometry.sectors_per_track) %
+            geometry.sectors_per_block != 0 ||
+        (long long)geometry.cylinders * geometry.tracks_per_cylinder *
+            geometry.sectors_per_track / geometry.sectors_per_block >
+            MAX_BLOCKS)
+        return false;
+
+    *p_geometry = geometry;
+    return true;
+}
 
-    if (((block - 1) % SECTORS_PER_TRACK) <=
-        (SECTORS_PER_TRACK / TRACKS_PER_CYLINDER))
-        *p_track = 0;
-    else
-        *p_track = 1;
+/**********************************************************************/
+/*  Read a whole number from zero to the largest allowed, returning   */
+/*                   -1 if the text is anything else                  */
+/**********************************************************************/
+long long parse_number(char *p_text, long long largest)
+{
+    long long value; /* The number read                               */
+    char extra;      /* Catches anything after the number             */
 
-    *p_sector = ((block - 1) % SECTORS_PER_TRACK) * SECTORS_PER_BLOCK;
+    if (sscanf(p_text, "%lld%c", &value, &extra) != 1 || value < 0 ||
+        value > largest)
+        return -1;
 
-    if (*p_sector > SECTORS_PER_TRACK)
-        *p_sector = *p_sector % SECTORS_PER_TRACK;
+    return value;
+}
+
+/**********************************************************************/
+/*     Work out the disk's derived sizes and build the block address  */
+/*                               table                                */
+/**********************************************************************/
+void load_geometry()
+{
+    int block,  /* Count the blocks                                   */
+        sector; /* The block's first sector within its cylinder       */
+
+    disk_geometry.bytes_per_block =
+        BYTES_PER_SECTOR * disk_geometry.sectors_per_block;
+    disk_geometry.blocks_per_cylinder =
+        disk_geometry.tracks_per_cylinder * disk_geometry.sectors_per_track /
+        disk_geometry.sectors_per_block;
+    disk_geometry.block_count =
+        disk_geometry.cylinders * disk_geometry.blocks_per_cylinder;
+
+    /* Convert every block once, so finding a block's place on the    */
+    /* disk never divides again                                       */
+    free(p_block_address);
+    if ((p_block_address = (BLOCK_ADDRESS *)malloc(
+             disk_geometry.block_count * sizeof(BLOCK_ADDRESS))) == NULL)
+    {
+        printf("\nError #%d occurred in load_geometry.", GEOMETRY_ALLOC_ERR);
+        printf("\nUnable to allocate memory for the block address table.");
+        printf("\nThe program is aborting.");
+        exit(GEOMETRY_ALLOC_ERR);
+    }
+    for (block = 0; block < disk_geometry.block_count; block++)
+    {
+        sector = block % disk_geometry.blocks_per_cylinder *
+                 disk_geometry.sectors_per_block;
+        p_block_address[block].cylinder =
+            block / disk_geometry.blocks_per_cylinder;
+        p_block_address[block].track =
+            sector / disk_geometry.sectors_per_track;
+        p_block_address[block].sector =
+            sector % disk_geometry.sectors_per_track;
+    }
 
     return;
 }
 
 /**********************************************************************/
-/*    Create an empty pending request list with header and trailer    */
+/*         Move the device on one step without waiting on it          */
 /**********************************************************************/
-REQUEST *create_list()
+void poll_device(DEVICE *p_device)
 {
-    REQUEST *p_new_list; /* Points to the new pending request list    */
+    TRANSFER *p_finished; /* Points to the transfer that just ended   */
 
-    if ((p_new_list = (REQUEST *)malloc(sizeof(REQUEST))) == NULL)
+    switch (p_device->state)
     {
-        printf("\nError #%d occurred in create_list.", HEADER_ALLOC_ERR);
-        printf("\nUnable to allocate memory for the list header.");
-        printf("\nThe program is aborting.");
-        exit(HEADER_ALLOC_ERR);
+    case DEVICE_SPINNING_UP:
+        if (device_command(p_device->device_number, STATUS_MOTOR,
+                           0, 0, 0, 0) != 0)
+            return;
+
+        /* Sense and set the disk heads current cylinder position     */
+        p_device->disk_heads = device_command(p_device->device_number,
+                                              SENSE_CYLINDER, 0, 0, 0, 0);
+        p_device->state = DEVICE_IDLE;
+        p_device->statistics.spin_up_time +=
+            disk_clock() - p_device->spin_up_start;
+        break;
+
+    case DEVICE_RECALIBRATING:
+        if (device_command(p_device->device_number, RECALIBRATE,
+                           0, 0, 0, 0) != 0)
+            return;
+
+        /* Carry on with the seeks from cylinder zero                 */
+        p_device->disk_heads = 0;
+        seek_cylinders(p_device);
+        return;
+
+    case DEVICE_TRANSFERRING:
+        if (device_command(
+                p_device->device_number,
+                p_device->p_transfer->p_first_request->operation_code == 1 ?
+                    READ_DATA : WRITE_DATA,
+                0, 0, 0, 0) != 0)
+            return;
+
+        /* Start a planned transfer before finishing this one, it has */
+        /* its own buffer so the device need not wait on the copying  */
+        p_finished = p_device->p_transfer;
+        p_device->state = DEVICE_IDLE;
+        if (p_device->p_lookahead->block_count > 0)
+            start_request(p_device);
+        finish_transfer(p_device, p_finished, 0);
+        if (p_device->state != DEVICE_IDLE)
+            return;
+        break;
     }
 
-    p_new_list->block_number = LIST_HEADER;
+    /* Start on the next request once the device is free              */
+    if (p_device->p_queue->request_count > 0 ||
+        p_device->p_lookahead->block_count > 0)
+        start_request(p_device);
+
+    return;
+}
+
+/**********************************************************************/
+/*  Start on the next transfer, planning it first if it is not yet    */
+/*                               planned                              */
+/**********************************************************************/
+void start_request(DEVICE *p_device)
+{
+    TRANSFER *p_next;        /* Points to the transfer to start       */
+    REQUEST *p_request;      /* Points to a request in the transfer   */
+    long long dispatch_time; /* When the transfer starts              */
 
-    if ((p_new_list->p_next_request = (REQUEST *)malloc(sizeof(REQUEST))) == NULL)
+    /* Turn the disk drive motor on if it is off, and come back once  */
+    /* it is up to speed                                              */
+    if (p_device->disk_on == false)
     {
-        printf("\nError #%d occurred in create_list.", TRAILER_ALLOC_ERR);
-        printf("\nUnable to allocate memory for the list trailer.");
-        printf("\nThe program is aborting.");
-        exit(TRAILER_ALLOC_ERR);
+        p_device->disk_on = device_command(p_device->device_number,
+                                           START_MOTOR, 0, 0, 0, 0);
+        p_device->state = DEVICE_SPINNING_UP;
+        p_device->spin_up_start = disk_clock();
+        p_device->statistics.motor_starts += 1;
+        return;
+    }
+
+    /* Take the planned transfer, or plan one now                     */
+    p_next = p_device->p_lookahead;
+    if (p_next->block_count == 0 && !plan_transfer(p_device, p_next))
+        return;
+    p_device->p_lookahead = p_device->p_transfer;
+    p_device->p_transfer = p_next;
+
+    /* Stamp the transfer's requests as they go to the device         */
+    dispatch_time = disk_clock();
+    for (p_request = p_next->p_first_request; p_request != NULL;
+         p_request = p_request->p_next_request)
+        p_request->dispatch_time = dispatch_time;
+
+    p_device->seek_next = 0;
+    seek_cylinders(p_device);
+
+    return;
+}
+
+/**********************************************************************/
+/*  Take the next request and its adjacent blocks off the queue and   */
+/*                   get them ready for the device                    */
+/**********************************************************************/
+bool plan_transfer(DEVICE *p_device, TRANSFER *p_transfer)
+{
+    REQUEST *p_current_request,  /* Points to the current request     */
+        *p_last_request,         /* Points to the highest merged block */
+        *p_next;                 /* Points to the next request to     */
+                                 /* take off the queue                */
+    int count_block,             /* Count the merged blocks           */
+        count_via;               /* Count edge cylinders passed       */
+
+    /* Choose the next request to process using a disk arm elevator   */
+    /* scheduling algorithm, every queued request being valid         */
+    if ((p_current_request = select_pending_request(
+             p_device->p_queue, &p_device->scheduler,
+             p_device->disk_heads)) == NULL)
+        return false;
+
+    /* Gather the run of adjacent blocks with the same operation on   */
+    /* either side of the request, the cylinder's list is in block    */
+    /* order so they sit right next to it.  Only a block's oldest     */
+    /* queued request joins, so none goes ahead of an older one       */
+    p_transfer->p_first_request = p_last_request = p_current_request;
+    p_transfer->block_count = 1;
+    while (p_transfer->block_count < driver_options.merge_blocks &&
+           can_merge(p_transfer->p_first_request->p_previous_request,
+                     p_transfer->p_first_request))
+    {
+        p_transfer->p_first_request =
+            p_transfer->p_first_request->p_previous_request;
+        p_transfer->block_count += 1;
+    }
+    while (p_transfer->block_count < driver_options.merge_blocks &&
+           can_merge(p_last_request, p_last_request->p_next_request))
+    {
+        p_last_request = p_last_request->p_next_request;
+        p_transfer->block_count += 1;
     }
 
-    p_new_list->p_next_request->block_number = LIST_TRAILER;
-    p_new_list->p_next_request->p_next_request = NULL;
+    /* Take the transfer's requests off the queue, so requests that   */
+    /* arrive before it ends cannot slip in among them                */
+    for (p_next = p_transfer->p_first_request, count_block = 0;
+         count_block < p_transfer->block_count;
+         p_next = p_next->p_next_request, count_block++)
+    {
+        remove_pending_request(p_next, p_device->p_queue);
+        p_device->p_queue->dispatch_count += 1;
+        if (p_next->p_cache_block != NULL)
+            p_next->p_cache_block->state = CACHE_FLUSHING;
+    }
+    p_last_request->p_next_request = NULL;
+
+    /* Plan the seeks past any edge cylinders to the request's own    */
+    p_transfer->seek_count = 0;
+    for (count_via = 0; count_via < p_device->scheduler.via_count;
+         count_via++)
+        p_transfer->seek_cylinder[p_transfer->seek_count++] =
+            p_device->scheduler.via_cylinder[count_via];
+    convert_block(p_transfer->p_first_request->block_number,
+                  &p_transfer->seek_cylinder[p_transfer->seek_count++],
+                  &p_transfer->sector, &p_transfer->track);
+
+    /* Read on past a stream's request into the cache while the heads */
+    /* are on its cylinder                                            */
+    p_transfer->read_ahead_count = 0;
+    p_transfer->read_ahead_block = p_last_request->block_number + 1;
+    if (p_device->p_cache != NULL && driver_options.read_ahead > 0 &&
+        p_last_request->operation_code == 1)
+        p_transfer->read_ahead_count =
+            plan_read_ahead(p_device->p_cache, p_transfer->read_ahead_block);
+
+    /* A lone block moves straight to or from its own memory, merged  */
+    /* blocks and blocks read ahead go through the transfer's buffer  */
+    p_transfer->p_address = p_transfer->p_first_request->p_data_address;
+    if (p_transfer->block_count + p_transfer->read_ahead_count > 1)
+    {
+        p_transfer->p_address = p_transfer->p_buffer;
+        if (p_transfer->p_first_request->operation_code == 2)
+            for (p_next = p_transfer->p_first_request, count_block = 0;
+                 p_next != NULL;
+                 p_next = p_next->p_next_request, count_block++)
+                memcpy((char *)p_transfer->p_buffer +
+                           count_block * disk_geometry.bytes_per_block,
+                       p_next->p_data_address,
+                       disk_geometry.bytes_per_block);
+    }
 
-    return p_new_list;
+    return true;
 }
 
 /**********************************************************************/
-/*       Create a new pending request and return its address          */
+/*  Move the heads through the request's cylinders, then start the    */
+/*                              transfer                              */
 /**********************************************************************/
-REQUEST *create_pending_request(MESSAGE fs_message)
+void seek_cylinders(DEVICE *p_device)
 {
-    REQUEST *p_new_request; /* Points to the new request              */
+    TRANSFER *p_transfer = p_device->p_transfer; /* The transfer      */
+    int cylinder; /* The cylinder to send the heads to                */
 
-    if ((p_new_request = (REQUEST *)malloc(sizeof(REQUEST))) == NULL)
+    while (p_device->seek_next < p_transfer->seek_count)
     {
-        printf("\nError #%d occurred in create_pending_request.",
-               REQUEST_ALLOC_ERR);
-        printf("\nUnable to allocate memory for a new request.");
-        printf("\nThe program is aborting.");
-        exit(REQUEST_ALLOC_ERR);
+        /* Send the disk heads to the cylinder unless already there   */
+        cylinder = p_transfer->seek_cylinder[p_device->seek_next];
+        if (p_device->disk_heads != cylinder)
+        {
+            p_device->statistics.seeks += 1;
+            p_device->statistics.cylinders_traveled +=
+                abs(cylinder - p_device->disk_heads);
+            record_sample(p_device->statistics.histogram[SEEK_DISTANCE],
+                          abs(cylinder - p_device->disk_heads));
+            p_device->disk_heads = device_command(p_device->device_number,
+                                                  SEEK_TO_CYLINDER, cylinder,
+                                                  0, 0, 0);
+        }
+
+        /* Check if the disk heads land correctly, recalibrating to   */
+        /* cylinder zero and trying again if not                      */
+        if (p_device->disk_heads == cylinder)
+            p_device->seek_next += 1;
+        else
+        {
+            p_device->statistics.recalibrations += 1;
+            if (device_command(p_device->device_number, RECALIBRATE,
+                               0, 0, 0, 0) != 0)
+            {
+                p_device->state = DEVICE_RECALIBRATING;
+                return;
+            }
+            p_device->disk_heads = 0;
+        }
     }
 
-    p_new_request->block_number = fs_message.block_number;
-    p_new_request->block_size = fs_message.block_size;
-    p_new_request->operation_code = fs_message.operation_code;
-    p_new_request->p_data_address = fs_message.p_data_address;
-    p_new_request->request_number = fs_message.request_number;
-    p_new_request->p_next_request = NULL;
+    start_transfer(p_device);
 
-    return p_new_request;
+    return;
 }
 
 /**********************************************************************/
-/*   Add a new pending request and put it in order by block number    */
+/*                Set up DMA and start the read or write              */
 /**********************************************************************/
-void add_pending_request(REQUEST *p_pending_request_list,
-                         REQUEST *p_new_request)
+void start_transfer(DEVICE *p_device)
 {
-    if (p_pending_request_list->p_next_request->p_next_request != NULL)
-        while (p_pending_request_list->p_next_request->block_number <=
-               p_new_request->block_number)
-            p_pending_request_list = p_pending_request_list->p_next_request;
+    TRANSFER *p_transfer = p_device->p_transfer; /* The transfer      */
+
+    /* Fail the transfer if DMA does not set up correctly             */
+    if (device_command(p_device->device_number, DMA_SETUP,
+                       p_transfer->sector, p_transfer->track,
+                       (p_transfer->block_count +
+                        p_transfer->read_ahead_count) *
+                           disk_geometry.bytes_per_block,
+                       p_transfer->p_address) != 0)
+    {
+        p_device->state = DEVICE_IDLE;
+        finish_transfer(p_device, p_transfer, DEVICE_ERR);
+        return;
+    }
 
-    p_new_request->p_next_request = p_pending_request_list->p_next_request;
-    p_pending_request_list->p_next_request = p_new_request;
+    /* Start the read or write, and come back once the device signals */
+    /* it is done                                                     */
+    p_device->statistics.transfers += 1;
+    p_device->statistics.blocks_moved +=
+        p_transfer->block_count + p_transfer->read_ahead_count;
+    p_device->state = DEVICE_TRANSFERRING;
+    if (device_command(p_device->device_number,
+                       p_transfer->p_first_request->operation_code == 1 ?
+                           READ_DATA : WRITE_DATA,
+                       0, 0, 0, 0) == 0)
+    {
+        p_device->state = DEVICE_IDLE;
+        finish_transfer(p_device, p_transfer, 0);
+    }
 
     return;
 }
 
 /**********************************************************************/
-/*      Remove the given request from the pending request list        */
+/*               Finish every request in the transfer                 */
 /**********************************************************************/
-void remove_pending_request(REQUEST *p_current_request,
-                            REQUEST *p_pending_request_list)
+void finish_transfer(DEVICE *p_device, TRANSFER *p_transfer,
+                     int error_code)
 {
-    REQUEST *p_current, /* Points to every request                    */
-        *p_previous;    /* Points to the previous request             */
+    REQUEST *p_next;      /* Points to the next request to finish     */
+    int count_block,      /* Count the merged blocks                  */
+        count_read_ahead; /* Count the blocks read ahead              */
+
+    /* Keep a running average of a transfer's time on the device for  */
+    /* the scheduler to weigh deadlines against                       */
+    p_device->scheduler.transfer_time +=
+        (disk_clock() - p_transfer->p_first_request->dispatch_time -
+         p_device->scheduler.transfer_time) / TRANSFER_AVERAGE_WEIGHT;
+
+    /* Hand read data back to each merged request's own memory        */
+    for (count_block = 0; p_transfer->p_first_request != NULL;
+         count_block++)
+    {
+        p_next = p_transfer->p_first_request->p_next_request;
+        if (p_transfer->p_address == p_transfer->p_buffer &&
+            error_code == 0 &&
+            p_transfer->p_first_request->operation_code == 1)
+            memcpy(p_transfer->p_first_request->p_data_address,
+                   (char *)p_transfer->p_buffer +
+                       count_block * disk_geometry.bytes_per_block,
+                   disk_geometry.bytes_per_block);
+        if (p_transfer->p_first_request->p_cache_block != NULL)
+            flush_cached_block(p_device->p_cache, p_device->p_queue,
+                               p_transfer->p_first_request->p_cache_block,
+                               error_code);
+        else
+        {
+            if (p_device->p_cache != NULL)
+                fill_cached_block(p_device->p_cache, p_device->p_queue,
+                                  p_transfer->p_first_request, error_code);
+            finish_pending_request(p_transfer->p_first_request,
+                                   p_device->p_queue, error_code);
+        }
+        p_transfer->p_first_request = p_next;
+    }
 
-    p_previous = p_pending_request_list;
-    while (p_current = p_previous->p_next_request,
-           p_current->request_number != p_current_request->request_number)
-        p_previous = p_current;
+    /* Keep the blocks read ahead, which follow the requests in the   */
+    /* buffer, in the cache                                           */
+    for (count_read_ahead = 0;
+         count_read_ahead < p_transfer->read_ahead_count;
+         count_read_ahead++, count_block++)
+        fill_read_ahead(p_device->p_cache, p_device->p_queue,
+                        p_transfer->read_ahead_block + count_read_ahead,
+                        (unsigned long int *)((char *)p_transfer->p_buffer +
+                            count_block * disk_geometry.bytes_per_block),
+                        error_code);
+    p_transfer->block_count = p_transfer->read_ahead_count = 0;
 
-    p_previous->p_next_request = p_current->p_next_request;
-    free(p_current);
+    return;
+}
+
+/**********************************************************************/
+/*            Check if two requests can share one transfer            */
+/**********************************************************************/
+bool can_merge(REQUEST *p_lower_request, REQUEST *p_higher_request)
+{
+    return p_lower_request != NULL && p_higher_request != NULL &&
+           p_higher_request->block_number ==
+               p_lower_request->block_number + 1 &&
+           p_higher_request->operation_code ==
+               p_lower_request->operation_code &&
+           p_lower_request->p_older_block == NULL &&
+           p_higher_request->p_older_block == NULL;
+}
+
+/**********************************************************************/
+/*  Convert physical block numbers into disk drive cylinder, track,   */
+/*                         and sector numbers                         */
+/**********************************************************************/
+void convert_block(int block, int *p_cylinder, int *p_sector, int *p_track)
+{
+    BLOCK_ADDRESS *p_address = &p_block_address[block - 1]; /* The   */
+                                                  /* block's address  */
+
+    *p_cylinder = p_address->cylinder;
+    *p_track = p_address->track;
+    *p_sector = p_address->sector;
+
+    return;
+}
+
+/**********************************************************************/
+/*     Serve a new request from the cache, or queue it for the device */
+/**********************************************************************/
+void accept_request(DEVICE *p_device, REQUEST *p_new_request)
+{
+    /* A sync has nothing to queue, it only waits on the cache        */
+    if (p_new_request->operation_code == SYNC_DEVICE)
+    {
+        if (p_device->p_cache == NULL)
+            finish_pending_request(p_new_request, p_device->p_queue, 0);
+        else
+            sync_cache(p_device->p_cache, p_device->p_queue, p_new_request);
+        return;
+    }
+
+    /* Let the cache serve or queue the request, or without a cache   */
+    /* let a queued request for the same block serve it               */
+    if (p_device->p_cache == NULL)
+        merge_pending_request(p_device->p_queue, p_new_request);
+    else if (p_new_request->operation_code == 1)
+        read_cached_block(p_device->p_cache, p_device->p_queue,
+                          p_new_request);
+    else
+        write_cached_block(p_device->p_cache, p_device->p_queue,
+                           p_new_request);
 
     return;
 }
 
+/**********************************************************************/
+/*  Fail an invalid message straight back to the file system, or      */
+/*          return false if the completion ring is full               */
+/**********************************************************************/
+bool reject_message(MESSAGE *p_message, int error_code)
+{
+    MESSAGE reply_message = *p_message; /* Reports the failure        */
+
+    reply_message.operation_code = error_code;
+    if (!push_ring(p_complete_ring, &reply_message))
+        return false;
+
+    /* A bad device number is counted on the first device             */
+    if (p_message->device_number > 0 &&
+        p_message->device_number < driver_options.devices)
+        device[p_message->device_number].statistics.errors += 1;
+    else
+        device[0].statistics.errors += 1;
+
+    return true;
+}
+
 /**********************************************************************/
 /*     Check for any invalid parameters and return the error code     */
 /**********************************************************************/
-int get_error_code(REQUEST *p_current)
+int get_error_code(MESSAGE *p_current)
 {
     int error_code = 0; /* The error code to be returned              */
 
     if (p_current->operation_code != 1 &&
-        p_current->operation_code != 2)
+        p_current->operation_code != 2 &&
+        p_current->operation_code != SYNC_DEVICE)
         error_code -= 1;
 
     if (p_current->request_number < 1)
         error_code -= 2;
 
-    if (!(p_current->block_number >= 1 &&
-          p_current->block_number <= (CYLINDERS_PER_DISK * SECTORS_PER_TRACK)))
+    /* A sync names no block                                          */
+    if (p_current->operation_code != SYNC_DEVICE &&
+        (p_current->block_number < 1 ||
+         p_current->block_number > disk_geometry.block_count))
         error_code -= 4;
 
     if ((p_current->block_size % 2) != 0 ||
         p_current->block_size < 0 ||
-        p_current->block_size > (BYTES_PER_SECTOR * SECTORS_PER_TRACK *
-                                 TRACKS_PER_CYLINDER))
+        p_current->block_size > (disk_geometry.blocks_per_cylinder *
+                                 disk_geometry.bytes_per_block))
         error_code -= 8;
 
-    if (p_current->p_data_address < 0)
+    /* A sync moves no data either                                    */
+    if (p_current->operation_code != SYNC_DEVICE &&
+        p_current->p_data_address == NULL)
         error_code -= 16;
 
+    if (p_current->device_number < 0 ||
+        p_current->device_number >= driver_options.devices)
+        error_code -= 128;
+
     return error_code;
 }
 
 /**********************************************************************/
-/*                         Set an idle message                        */
+/*              Set a message reporting a finished request            */
 /**********************************************************************/
-void set_idle_message(MESSAGE *fs_message)
+void set_reply_message(MESSAGE *fs_message, REQUEST *p_request)
 {
-    (*fs_message).operation_code = (*fs_message).request_number =
-        (*fs_message).block_number = (*fs_message).block_size = 0;
-    (*fs_message).p_data_address = NULL;
+    (*fs_message).operation_code = p_request->error_code;
+    (*fs_message).request_number = p_request->request_number;
+    (*fs_message).block_number = p_request->block_number;
+    (*fs_message).device_number = p_request->device_number;
+    (*fs_message).block_size = p_request->block_size;
+    (*fs_message).p_data_address = p_request->p_data_address;
 
     return;
 }
+
+/**********************************************************************/
+/*         Check if the finished requests should be reported now      */
+/**********************************************************************/
+bool batch_is_due(bool intake_blocked)
+{
+    DEVICE *p_oldest;       /* Points to the device with the oldest   */
+                            /* finished request                       */
+    bool devices_idle = true; /* No device has work queued or under   */
+                              /* way                                  */
+    int device_number,      /* Count the devices                      */
+        finished_count = 0; /* Finished requests on every device      */
+
+    /* Finished requests go at once when the file system is held back */
+    /* for want of the nodes they hold, and otherwise once the batch  */
+    /* is full, the oldest has waited long enough, or there is        */
+    /* nothing queued or on any device to add to the batch            */
+    if ((p_oldest = find_oldest_finished()) == NULL)
+        return false;
+    if (intake_blocked)
+        return true;
+
+    for (device_number = 0; device_number < driver_options.devices;
+         device_number++)
+    {
+        finished_count += device[device_number].p_queue->finished_count;
+        if (device[device_number].p_queue->request_count > 0 ||
+            device[device_number].state != DEVICE_IDLE)
+            devices_idle = false;
+    }
+
+    return finished_count >= driver_options.batch_size || devices_idle ||
+           disk_clock() - p_oldest->p_queue->p_first_finished->finish_time
+               >= driver_options.flush_time;
+}
+
+/**********************************************************************/
+/*   Return the device with the oldest finished request, or NULL      */
+/**********************************************************************/
+DEVICE *find_oldest_finished()
+{
+    DEVICE *p_oldest = NULL; /* Points to the device found so far     */
+    int device_number;       /* Count the devices                     */
+
+    for (device_number = 0; device_number < driver_options.devices;
+         device_number++)
+        if (device[device_number].p_queue->p_first_finished != NULL &&
+            (p_oldest == NULL ||
+             device[device_number].p_queue->p_first_finished->finish_time <
+                 p_oldest->p_queue->p_first_finished->finish_time))
+            p_oldest = &device[device_number];
+
+    return p_oldest;
+}
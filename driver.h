@@ -0,0 +1,808 @@
+/**********************************************************************/
+/*                                                                    */
+/* Header Name:  driver.h - Shared declarations for the disk driver   */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This header holds the symbolic constants, structures, and function */
+/* prototypes shared by the driver main loop and its modules, plus    */
+/* the disk device and file system interface the driver is linked     */
+/* against.                                                           */
+/*                                                                    */
+/**********************************************************************/
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+/**********************************************************************/
+/*                         Symbolic Constants                         */
+/**********************************************************************/
+#define DEFAULT_CYLINDERS 40    /* Default cylinders in a disk        */
+#define DEFAULT_TRACKS 2        /* Default tracks in a cylinder       */
+#define DEFAULT_SECTORS 9       /* Default sectors in a track         */
+#define DEFAULT_SECTORS_PER_BLOCK 2 /* Default sectors in a block     */
+#define BYTES_PER_SECTOR 512    /* Number of bytes in a sector        */
+#define MAX_CYLINDERS 65535     /* Most cylinders a disk may have     */
+#define MAX_TRACKS 255          /* Most tracks a cylinder may have    */
+#define MAX_SECTORS 255         /* Most sectors a track may have      */
+#define MAX_BLOCKS 16777216     /* Most blocks a disk may have        */
+#define QUEUE_ALLOC_ERR 1       /* Queue memory allocation error      */
+#define OPTION_ERR 4            /* Invalid command line option error  */
+#define GEOMETRY_ALLOC_ERR 7    /* Block table or transfer buffer     */
+                                /* memory allocation error            */
+#define CACHE_ALLOC_ERR 8       /* Block cache allocation error       */
+#define RING_ALLOC_ERR 9        /* Message ring allocation error      */
+#define TRACE_ERR 10            /* The trace file cannot be opened    */
+#define DEVICE_ERR -64          /* The device refused the transfer    */
+#define SYNC_DEVICE 3           /* File system sync code number, ends */
+                                /* once every cached write before it  */
+                                /* is on the disk                     */
+#define MAX_DEVICES 4           /* Most disk devices the driver runs  */
+#define IDLE_WAIT_TIME 10000    /* Longest the driver sleeps waiting  */
+                                /* for an event                       */
+#define MOTOR_POWER 2000        /* Milliwatts a running motor draws   */
+#define SPIN_UP_POWER 6000      /* Milliwatts a motor draws while     */
+                                /* spinning up                        */
+#define DEFAULT_SPIN_UP_TIME 500000 /* Spin up time assumed until one */
+                                    /* has been timed                 */
+#define SHORT_SPIN_DOWN_TIME 20000 /* Idle time before the motor is   */
+                                   /* stopped when a long idle time   */
+                                   /* is expected                     */
+#define LONG_IDLE_FACTOR 2      /* Average idle times over this many  */
+                                /* break even times are long          */
+#define IDLE_AVERAGE_WEIGHT 2   /* The newest idle time counts for    */
+                                /* one over this of the average       */
+#define SENSE_CYLINDER 1        /* Sense cylinder code number         */
+#define SEEK_TO_CYLINDER 2      /* Seek to cylinder code number       */
+#define DMA_SETUP 3             /* DMA setup code number              */
+#define START_MOTOR 4           /* Start motor code number            */
+#define STATUS_MOTOR 5          /* Status motor code number           */
+#define READ_DATA 6             /* Read data code number              */
+#define WRITE_DATA 7            /* Write data code number             */
+#define STOP_MOTOR 8            /* Stop motor code number             */
+#define RECALIBRATE 9           /* Recalibrate code number            */
+#define MAX_PENDING_REQUESTS 20 /* Most finished requests reported at */
+                                /* once                               */
+#define RING_ENTRIES 64         /* Messages each ring holds           */
+#define CACHE_LINE_BYTES 64     /* Bytes in a processor cache line    */
+#define DEFAULT_POOL_REQUESTS 160 /* Default request nodes in the     */
+                                  /* request pool                     */
+#define SCAN 0                  /* Sweep to the edge, then reverse    */
+#define CIRCULAR_SCAN 1         /* Sweep up to the edge, then return  */
+                                /* to cylinder zero                   */
+#define LOOK 2                  /* Sweep to the last request, then    */
+                                /* reverse                            */
+#define CIRCULAR_LOOK 3         /* Sweep up to the last request, then */
+                                /* wrap to the lowest request         */
+#define SHORTEST_SEEK_FIRST 4   /* Always take the nearest cylinder   */
+#define DEADLINE 5              /* LOOK, but serve any request passed */
+                                /* over too long first                */
+#define DEFAULT_EXPIRE_DISPATCHES 40 /* Dispatches a request may be   */
+                                     /* passed over under DEADLINE    */
+#define DEFAULT_FLUSH_TIME 20000 /* Microseconds a finished request    */
+                                 /* may wait for its batch to fill     */
+#define DEVICE_IDLE 0           /* Ready for the next request         */
+#define DEVICE_SPINNING_UP 1    /* Waiting for the motor to reach     */
+                                /* speed                              */
+#define DEVICE_RECALIBRATING 2  /* Waiting for the heads to reach     */
+                                /* cylinder zero after a bad seek     */
+#define DEVICE_TRANSFERRING 3   /* Waiting for a read or write to end */
+#define DEVICE_EVENT 1          /* The device finished its command    */
+#define MESSAGE_EVENT 2         /* The file system has requests ready */
+#define BITS_PER_MAP_WORD 64    /* Cylinders tracked per bitmap word  */
+#define CACHE_READING 1         /* Cached block waits on a disk read  */
+#define CACHE_CLEAN 2           /* Cached block matches the disk      */
+#define CACHE_DIRTY 3           /* Cached block waits to be written   */
+                                /* back, its write back is queued     */
+#define CACHE_FLUSHING 4        /* Cached block is being written back */
+#define CACHE_WRITING 5         /* Cached block waits on writes sent  */
+                                /* around the cache                   */
+#define MAX_STREAMS 4           /* Read streams followed per device   */
+#define READ_AHEAD_RUN 2        /* Ascending reads in a row that make */
+                                /* a stream worth reading ahead of    */
+#define HISTOGRAM_BUCKETS 40    /* Power of two buckets in each       */
+                                /* histogram, the last one open ended */
+#define READ_LATENCY 0          /* Histogram of read latencies        */
+#define WRITE_LATENCY 1         /* Histogram of write latencies       */
+#define SYNC_LATENCY 2          /* Histogram of sync latencies        */
+#define QUEUE_WAIT 3            /* Histogram of queue to dispatch     */
+                                /* times                              */
+#define SERVICE_TIME 4          /* Histogram of dispatch to finish    */
+                                /* times                              */
+#define SEEK_DISTANCE 5         /* Histogram of cylinders per seek    */
+#define CLASS_LATENCY 6         /* First of the histograms of each    */
+                                /* priority class's latencies         */
+#define HISTOGRAMS 9            /* Histograms kept for each device    */
+#define PRIORITY_URGENT 0       /* The file system is waiting on the  */
+                                /* request                            */
+#define PRIORITY_NORMAL 1       /* An ordinary request                */
+#define PRIORITY_BACKGROUND 2   /* Nothing waits on the request, as   */
+                                /* with a cache write back            */
+#define PRIORITY_CLASSES 3      /* Priority classes, each queued on   */
+                                /* its own                            */
+#define TRANSFER_AVERAGE_WEIGHT 8 /* The newest transfer time counts */
+                                  /* for one over this of the average */
+#define DEADLINE_SLACK_TRANSFERS 3 /* Transfers' time left before a   */
+                                   /* deadline that puts its request  */
+                                   /* ahead of the elevator           */
+#define TRACE_MAGIC "DRVTRC3"   /* Marks the start of a trace file    */
+#define TRACE_BUFFER_BYTES 65536 /* Trace records written at a time   */
+#define TRACE_MESSAGE 1         /* Trace record of a message taken in */
+#define TRACE_COMMAND 2         /* Trace record of a device command   */
+
+/**********************************************************************/
+/*                         Program Structures                         */
+/**********************************************************************/
+/* A file system request list entry                                   */
+struct message
+{
+    int operation_code;                /* The disk operation to be    */
+                                       /* performed                   */
+    int request_number;                /* A unique request number     */
+    int block_number;                  /* The block number to be read */
+                                       /* or written                  */
+    int device_number;                 /* The disk device holding the */
+                                       /* block, from 0               */
+    int block_size;                    /* The block size in bytes     */
+    int priority;                      /* The request's priority      */
+                                       /* class, urgent first         */
+    long long deadline_time;           /* Microseconds after it is    */
+                                       /* taken in the request must   */
+                                       /* be finished within, 0 for   */
+                                       /* no deadline                 */
+    unsigned long int *p_data_address; /* Points to the data block in */
+                                       /* memory                      */
+};
+typedef struct message MESSAGE;
+
+/* One message in a ring                                              */
+struct ring_slot
+{
+    atomic_uint sequence;              /* The position the slot is     */
+                                       /* free for, or that position   */
+                                       /* plus one once it is filled   */
+    unsigned int position;             /* The position claimed, kept   */
+                                       /* by the producer filling it   */
+    MESSAGE message;                   /* The message held             */
+};
+typedef struct ring_slot RING_SLOT;
+
+/* A ring of messages with many producers and one consumer            */
+struct message_ring
+{
+    _Alignas(CACHE_LINE_BYTES)
+    atomic_uint tail;                  /* The next position for a      */
+                                       /* producer to claim            */
+    _Alignas(CACHE_LINE_BYTES)
+    unsigned int head,                 /* The next position for the    */
+                                       /* consumer to take             */
+        mask;                          /* Slots in the ring less one   */
+    _Alignas(CACHE_LINE_BYTES)
+    RING_SLOT slot[];                  /* The slots, allocated with    */
+                                       /* the ring                     */
+};
+typedef struct message_ring MESSAGE_RING;
+extern MESSAGE_RING *p_submit_ring,    /* Requests from the file       */
+                                       /* system                       */
+    *p_complete_ring;                  /* Finished requests to the     */
+                                       /* file system                  */
+
+/* The disk's layout, read at startup                                 */
+struct geometry
+{
+    int cylinders,           /* Number of cylinders in a disk           */
+        tracks_per_cylinder, /* Number of tracks in a cylinder          */
+        sectors_per_track,   /* Number of sectors in a track            */
+        sectors_per_block,   /* Number of sectors in a block            */
+        bytes_per_block,     /* Number of bytes in a block              */
+        blocks_per_cylinder, /* Number of blocks in a cylinder          */
+        block_count;         /* Number of blocks in a disk              */
+};
+typedef struct geometry GEOMETRY;
+extern GEOMETRY disk_geometry; /* The geometry of every disk device    */
+
+/* Where one block starts on the disk                                 */
+struct block_address
+{
+    unsigned short cylinder;   /* The block's cylinder                  */
+    unsigned char track,       /* The block's first track               */
+                  sector;      /* The block's first sector              */
+};
+typedef struct block_address BLOCK_ADDRESS;
+extern BLOCK_ADDRESS *p_block_address; /* Every block's address,       */
+                                       /* indexed by block number - 1  */
+
+/* A pending request list entry                                        */
+struct request
+{
+    int block_number,                  /* The block number to be read  */
+                                       /* or written                   */
+        block_size,                    /* The block size in bytes      */
+        operation_code,                /* The disk operation to be     */
+                                       /* performed                    */
+        request_number,                /* A unique request number      */
+        device_number,                 /* The disk device holding the  */
+                                       /* block                        */
+        cylinder,                      /* The cylinder the request is  */
+                                       /* queued under                 */
+        dispatch_stamp,                /* Dispatch count when the      */
+                                       /* request was queued           */
+        priority,                      /* The request's priority class */
+        error_code;                    /* Error code to report when    */
+                                       /* the request is finished      */
+    long long queue_time,              /* Device clock when the        */
+                                       /* request was taken in         */
+        deadline,                      /* Device clock the request     */
+                                       /* must be finished by, or -1   */
+                                       /* for no deadline              */
+        dispatch_time,                 /* Device clock when the        */
+                                       /* request's transfer started,  */
+                                       /* -1 if it never went to the   */
+                                       /* device                       */
+        finish_time,                   /* Device clock when the        */
+                                       /* request was finished         */
+        sync_sequence;                 /* Cached writes before a sync  */
+                                       /* request arrived              */
+    unsigned long int *p_data_address; /* Points to the data block in  */
+                                       /* memory                       */
+    struct request *p_next_request,    /* Points to the next request   */
+                                       /* in the same cylinder         */
+        *p_previous_request,           /* Points to the previous       */
+                                       /* request in the same cylinder */
+        *p_next_arrival,               /* Points to the next newer     */
+                                       /* request in the queue         */
+        *p_previous_arrival,           /* Points to the next older     */
+                                       /* request in the queue         */
+        *p_next_deadline,              /* Points to the request with   */
+                                       /* the next later deadline      */
+        *p_previous_deadline,          /* Points to the request with   */
+                                       /* the next earlier deadline    */
+        *p_next_hash,                  /* Points to the next request   */
+                                       /* in the same block index      */
+                                       /* bucket                       */
+        *p_older_block,                /* Points to the next older     */
+                                       /* queued request for the same  */
+                                       /* block                        */
+        *p_newer_block,                /* Points to the next newer     */
+                                       /* queued request for the same  */
+                                       /* block                        */
+        *p_first_duplicate;            /* Points to the first read of  */
+                                       /* the same block waiting on    */
+                                       /* this one                     */
+    struct cache_block *p_cache_block; /* Points to the cached block a */
+                                       /* write back is for, or NULL   */
+};
+typedef struct request REQUEST;
+
+/* One priority class's pending requests, indexed by cylinder         */
+struct class_queue
+{
+    REQUEST **p_first_request,         /* Lowest block in each         */
+                                       /* cylinder                     */
+        **p_last_request,              /* Highest block in each        */
+                                       /* cylinder                     */
+        *p_oldest_request,             /* Points to the oldest request */
+        *p_newest_request;             /* Points to the newest request */
+    unsigned long long *p_cylinder_map; /* One bit set for every       */
+                                       /* cylinder with requests       */
+    int request_count;                 /* Number of pending requests   */
+};
+typedef struct class_queue CLASS_QUEUE;
+
+/* A device's pending requests, queued by priority class              */
+struct pending_queue
+{
+    CLASS_QUEUE class_queue[PRIORITY_CLASSES]; /* Each priority        */
+                                       /* class's requests             */
+    int cylinders,                     /* Cylinders in the queue's     */
+                                       /* disk                         */
+        map_words,                     /* Words in the cylinder bitmap */
+        request_count,                 /* Number of pending requests   */
+        dispatch_count,                /* Requests sent to the device  */
+                                       /* so far                       */
+        finished_count;                /* Finished requests not yet    */
+                                       /* reported                     */
+    REQUEST **p_block_hash,            /* The newest queued request    */
+                                       /* for each block, by block     */
+                                       /* number                       */
+        *p_first_deadline,             /* Points to the request with   */
+                                       /* the earliest deadline        */
+        *p_last_deadline,              /* Points to the request with   */
+                                       /* the latest deadline          */
+        *p_first_finished,             /* Points to the first finished */
+                                       /* request not yet reported     */
+        *p_last_finished,              /* Points to the last finished  */
+                                       /* request not yet reported     */
+        *p_free_request;               /* Points to the first free     */
+                                       /* request node in the pool     */
+    int hash_mask,                     /* Block index buckets less one */
+        pool_size,                     /* Request nodes in the pool    */
+        pool_in_use,                   /* Request nodes handed out     */
+        pool_high_water,               /* Most nodes ever in use       */
+        pool_exhaustions;              /* Times a request had to wait  */
+                                       /* for a node because the pool  */
+                                       /* was empty                    */
+    long long merged_reads,            /* Reads that waited on a       */
+                                       /* queued read of their block   */
+        forwarded_reads,               /* Reads answered from a queued */
+                                       /* write of their block         */
+        superseded_writes;             /* Queued writes replaced by a  */
+                                       /* later write of their block   */
+    REQUEST pool_request[];            /* The request nodes, allocated */
+                                       /* with the queue               */
+};
+typedef struct pending_queue PENDING_QUEUE;
+
+/* One block held in a device's cache                                 */
+struct cache_block
+{
+    int block_number,                  /* The block held               */
+        state,                         /* Reading, clean, dirty,       */
+                                       /* flushing, or writing         */
+        writes_around;                 /* Writes to the block sent     */
+                                       /* around the cache, unfinished */
+    long long dirty_sequence;          /* Cached writes when the block */
+                                       /* was first dirtied            */
+    bool read_ahead;                   /* Read ahead and not yet asked */
+                                       /* for                          */
+    struct cache_block *p_next_hash,   /* Points to the next block in  */
+                                       /* the same hash bucket         */
+        *p_newer,                      /* Points to the next newer     */
+                                       /* clean or dirty block         */
+        *p_older;                      /* Points to the next older     */
+                                       /* clean or dirty block         */
+    unsigned long int *p_data;         /* Points to the block's data   */
+    REQUEST *p_first_waiting;          /* Points to the first read     */
+                                       /* waiting on the block's data  */
+    REQUEST flush_request;             /* Writes the block back to the */
+                                       /* disk                         */
+};
+typedef struct cache_block CACHE_BLOCK;
+
+/* A run of ascending reads followed for read ahead                   */
+struct read_stream
+{
+    int next_block,                    /* The block the run reads next */
+        run_length;                    /* Reads in the run so far      */
+};
+typedef struct read_stream READ_STREAM;
+
+/* A device's cache of recently used blocks                           */
+struct block_cache
+{
+    CACHE_BLOCK **p_hash_bucket,       /* Cached blocks by block       */
+                                       /* number                       */
+        *p_most_recent,                /* Points to the newest clean   */
+                                       /* block                        */
+        *p_least_recent,               /* Points to the oldest clean   */
+                                       /* block, evicted first         */
+        *p_first_dirty,                /* Points to the block dirty    */
+                                       /* the longest                  */
+        *p_last_dirty,                 /* Points to the newest dirty   */
+                                       /* block                        */
+        *p_free_block;                 /* Points to the first unused   */
+                                       /* block                        */
+    REQUEST *p_first_sync,             /* Points to the oldest sync    */
+                                       /* waiting on write backs       */
+        *p_last_sync;                  /* Points to the newest sync    */
+                                       /* waiting on write backs       */
+    READ_STREAM stream[MAX_STREAMS];   /* The read streams followed    */
+    int block_count,                   /* Blocks the cache holds       */
+        hash_mask,                     /* Hash buckets less one        */
+        next_stream,                   /* The stream a new run takes   */
+                                       /* over next                    */
+        untracked_writes;              /* Unfinished writes sent       */
+                                       /* around with no cache block   */
+                                       /* to follow them               */
+    long long write_sequence,          /* Writes cached so far         */
+        read_hits,                     /* Reads served from the cache  */
+        read_misses,                   /* Reads sent on to the disk    */
+        absorbed_writes,               /* Writes finished in the cache */
+        flushes,                       /* Blocks written back          */
+        flush_errors,                  /* Write backs the disk failed  */
+        read_aheads,                   /* Blocks read ahead            */
+        read_ahead_hits,               /* Reads of blocks read ahead   */
+        read_ahead_waste;              /* Blocks read ahead, then      */
+                                       /* evicted or overwritten       */
+                                       /* unread                       */
+    CACHE_BLOCK cache_block[];         /* The cached blocks, allocated */
+                                       /* with the cache               */
+};
+typedef struct block_cache BLOCK_CACHE;
+
+/* The disk arm scheduler's state between requests                    */
+struct scheduler
+{
+    int policy,             /* The scheduling policy in use             */
+        direction,          /* Sweep direction, 1 up or -1 down         */
+        expire_dispatches,  /* Dispatches a request may wait under      */
+                            /* DEADLINE before it is served first       */
+        via_count,          /* Edge cylinders to pass before the        */
+                            /* chosen request                           */
+        via_cylinder[2];    /* The edge cylinders, in order             */
+    long long transfer_time, /* Running average of a transfer's time on */
+                            /* the device                               */
+        deadline_dispatches; /* Requests sent ahead of the elevator to  */
+                            /* meet their deadlines                     */
+};
+typedef struct scheduler SCHEDULER;
+
+/* A transfer of one or more adjacent blocks                          */
+struct transfer
+{
+    int seek_count,         /* Cylinders to visit for the transfer      */
+        seek_cylinder[3],   /* Edge cylinders, then the transfer's own  */
+        block_count,        /* Requests in the transfer, 0 for none     */
+        read_ahead_count,   /* Blocks read ahead after the requests     */
+        read_ahead_block,   /* The first block read ahead               */
+        sector,             /* The transfer's first sector              */
+        track;              /* The transfer's first track               */
+    REQUEST *p_first_request; /* The transfer's lowest block, the rest  */
+                              /* follow it in block order               */
+    unsigned long int *p_buffer, /* Holds the data of a merged transfer */
+        *p_address;              /* The transfer's DMA memory address   */
+};
+typedef struct transfer TRANSFER;
+
+/* What a device has done since the driver started                    */
+struct statistics
+{
+    long long reads,            /* Reads reported done                  */
+        writes,                 /* Writes reported done                 */
+        syncs,                  /* Syncs reported done                  */
+        errors,                 /* Requests reported with an error      */
+        transfers,              /* Reads and writes started on the disk */
+        blocks_moved,           /* Blocks the transfers moved           */
+        seeks,                  /* Seeks that moved the heads           */
+        cylinders_traveled,     /* Cylinders the seeks crossed          */
+        recalibrations,         /* Recalibrations after a bad seek      */
+        motor_starts,           /* Times the motor was started          */
+        motor_stops,            /* Times the motor was stopped          */
+        early_spin_downs,       /* Stops followed by work within the    */
+                                /* break even time                      */
+        motor_on_time,          /* Time the motor ran before its last   */
+                                /* stop                                 */
+        deadline_misses[PRIORITY_CLASSES],
+                                /* Requests of each class finished      */
+                                /* after their deadlines                */
+        spin_up_time;           /* Time spent waiting on the motor to   */
+                                /* reach speed                          */
+    long long histogram[HISTOGRAMS][HISTOGRAM_BUCKETS];
+                                /* Samples by power of two, bucket n    */
+                                /* holds values below 2 to the n        */
+};
+typedef struct statistics STATISTICS;
+
+/* One disk device with its own queue, scheduler, and progress        */
+struct device
+{
+    int device_number,      /* The device's number, from 0              */
+        state,              /* What the driver is waiting on the        */
+                            /* device for                               */
+        disk_heads,         /* Current disk heads' position in          */
+                            /* cylinder number                          */
+        seek_next;          /* The next cylinder of the transfer to     */
+                            /* visit                                    */
+    long long spin_up_start, /* Device clock when the motor was last    */
+                            /* started                                  */
+        idle_start,         /* Device clock when the device last ran    */
+                            /* out of work, -1 while it has work        */
+        idle_average;       /* Running average of the device's idle     */
+                            /* times                                    */
+    bool disk_on,           /* Disk drive status                        */
+         signalled,         /* The device has signalled since it was    */
+                            /* last polled                              */
+         message_held;      /* A message is held for want of a node     */
+    MESSAGE held_message;   /* The message taken from the submission    */
+                            /* ring while the pool was empty            */
+    PENDING_QUEUE *p_queue; /* Points to the device's pending request   */
+                            /* queue                                    */
+    BLOCK_CACHE *p_cache;   /* Points to the device's block cache, or   */
+                            /* NULL for none                            */
+    SCHEDULER scheduler;    /* The device's disk arm scheduler          */
+    TRANSFER *p_transfer,   /* The transfer under way                   */
+        *p_lookahead,       /* The next transfer, planned while the     */
+                            /* current one runs                         */
+        transfer[2];        /* The two transfers, used in turn          */
+    STATISTICS statistics;  /* What the device has done                 */
+};
+typedef struct device DEVICE;
+
+/* Driver settings taken from the command line                        */
+struct options
+{
+    int pool_requests,     /* Request nodes to allocate at startup      */
+        policy,            /* The disk arm scheduling policy            */
+        expire_dispatches, /* DEADLINE expiry in dispatches             */
+        merge_blocks,      /* Most adjacent blocks moved in a single    */
+                           /* transfer, 0 for a whole cylinder          */
+        batch_size,        /* Finished requests reported per message    */
+        lookahead,         /* Plan the next transfer while the current  */
+                           /* one runs, 1 for yes or 0 for no           */
+        devices,           /* Disk devices attached, numbered from 0    */
+        cache_kbytes,      /* Block cache memory for each device in     */
+                           /* kilobytes, 0 for no cache                 */
+        read_ahead;        /* Most blocks read ahead of a stream into   */
+                           /* the cache, 0 for none                     */
+    long long flush_time,  /* Longest a finished request waits for its */
+                           /* batch to fill                             */
+        spin_down_time;    /* Idle time before the motor is stopped, 0  */
+                           /* to work it out from the device's idle     */
+                           /* times                                     */
+    char *p_stats_path,    /* File the statistics are added to, NULL    */
+                           /* for standard error                        */
+        *p_trace_path;     /* File the messages and device commands are */
+                           /* traced to, NULL for no trace              */
+};
+typedef struct options OPTIONS;
+
+/* The start of a trace file                                          */
+struct trace_header
+{
+    char magic[8];           /* TRACE_MAGIC, with its version           */
+    long long start_time;    /* The device clock when tracing started   */
+    int record_bytes,        /* Bytes in each record that follows       */
+        devices,             /* Disk devices traced                     */
+        cylinders,           /* Cylinders in each disk                  */
+        tracks_per_cylinder, /* Tracks in each cylinder                 */
+        sectors_per_track,   /* Sectors in each track                   */
+        sectors_per_block;   /* Sectors in each block                   */
+};
+typedef struct trace_header TRACE_HEADER;
+
+/* A message or device command in a trace file                        */
+struct trace_record
+{
+    long long time,     /* The device clock when it was recorded        */
+        value[3];       /* The message's block number, priority, and    */
+                        /* deadline, or the command's arguments         */
+    int kind,           /* TRACE_MESSAGE or TRACE_COMMAND               */
+        device_number,  /* The device it was for                        */
+        operation_code, /* The message's operation or the command       */
+        result;         /* The status the command gave back             */
+};
+typedef struct trace_record TRACE_RECORD;
+
+extern OPTIONS driver_options; /* The driver's runtime settings        */
+extern DEVICE device[MAX_DEVICES]; /* The disk devices                 */
+extern char *p_policy_name[];  /* Scheduling policy names, in order    */
+extern char *p_class_name[];   /* Priority class names, most urgent    */
+                               /* first                                */
+extern char *p_histogram_name[]; /* Histogram names, in histogram      */
+                                 /* order                              */
+
+/**********************************************************************/
+/*                        Function Prototypes                         */
+/**********************************************************************/
+/* Disk device and file system interface, supplied at link time       */
+int disk_drive(int device_number, int operation_code, int argument_1,
+               int argument_2, int argument_3,
+               unsigned long int *p_data_address);
+/* Send a command to a disk device and return its status              */
+void notify_file_system();
+/* Tell the file system finished requests wait in the completion ring */
+long long disk_clock();
+/* Return the device's clock in microseconds                          */
+int wait_event(long long wait_time, int *p_device_number);
+/* Sleep until a device or the file system signals, or the time is    */
+/* up, and return the event or 0                                      */
+
+/* driver.c                                                           */
+void run_driver();
+/* Run the driver, moving requests between the file system and disk   */
+void parse_options(int argc, char *argv[]);
+/* Read the runtime settings from the command line                    */
+bool parse_geometry(char *p_text, GEOMETRY *p_geometry);
+/* Read a cylinders,tracks,sectors,sectors-per-block geometry and     */
+/* check it, returning false if it is invalid                         */
+long long parse_number(char *p_text, long long largest);
+/* Read a whole number from zero to the largest allowed, returning -1 */
+/* if the text is anything else                                       */
+void load_geometry();
+/* Work out the disk's derived sizes and build the block address      */
+/* table                                                              */
+void poll_device(DEVICE *p_device);
+/* Move the device on one step without waiting on it                  */
+void start_request(DEVICE *p_device);
+/* Start on the next transfer, planning it first if it is not yet     */
+/* planned                                                            */
+bool plan_transfer(DEVICE *p_device, TRANSFER *p_transfer);
+/* Take the next request and its adjacent blocks off the queue and    */
+/* get them ready for the device                                      */
+void seek_cylinders(DEVICE *p_device);
+/* Move the heads through the request's cylinders, then start the     */
+/* transfer                                                           */
+void start_transfer(DEVICE *p_device);
+/* Set up DMA and start the read or write                             */
+void finish_transfer(DEVICE *p_device, TRANSFER *p_transfer,
+                     int error_code);
+/* Finish every request in the transfer                               */
+bool can_merge(REQUEST *p_lower_request, REQUEST *p_higher_request);
+/* Check if two requests can share one transfer                       */
+void set_reply_message(MESSAGE *fs_message, REQUEST *p_request);
+/* Set a message reporting a finished request                         */
+bool batch_is_due(bool intake_blocked);
+/* Check if the finished requests should be reported now              */
+DEVICE *find_oldest_finished();
+/* Return the device with the oldest finished request, or NULL        */
+void convert_block(int block, int *p_cylinder, int *p_sector, int *p_track);
+/* Convert physical block numbers into disk drive cylinder, track,    */
+/* and sector numbers                                                 */
+void accept_request(DEVICE *p_device, REQUEST *p_new_request);
+/* Serve a new request from the cache, or queue it for the device     */
+bool reject_message(MESSAGE *p_message, int error_code);
+/* Fail an invalid message straight back to the file system, or       */
+/* return false if the completion ring is full                        */
+int get_error_code(MESSAGE *p_current);
+/* Check for any invalid parameters and return the error code         */
+
+/* pending.c                                                          */
+PENDING_QUEUE *create_list(int pool_size, int cylinders);
+/* Create an empty pending request queue and its request pool         */
+REQUEST *create_pending_request(PENDING_QUEUE *p_pending_request_list,
+                                MESSAGE fs_message);
+/* Take a request node from the pool, or NULL if the pool is empty    */
+void free_pending_request(REQUEST *p_request,
+                          PENDING_QUEUE *p_pending_request_list);
+/* Return a request node to the pool                                  */
+void add_pending_request(PENDING_QUEUE *p_pending_request_list,
+                         REQUEST *p_new_request);
+/* Add a new pending request to its cylinder in order by block number */
+REQUEST *find_queued_block(PENDING_QUEUE *p_pending_request_list,
+                           int block_number);
+/* Return the newest queued request for a block, or NULL if there is  */
+/* none                                                               */
+void drop_queued_block(PENDING_QUEUE *p_pending_request_list,
+                       REQUEST *p_request);
+/* Take a request out of the block index if it is there               */
+REQUEST *first_queued_block(REQUEST *p_request);
+/* Return the oldest queued request for the same block as a request   */
+void merge_pending_request(PENDING_QUEUE *p_pending_request_list,
+                           REQUEST *p_new_request);
+/* Let a queued request for the same block serve a new request, or    */
+/* add the new request to the queue                                   */
+void remove_pending_request(REQUEST *p_current_request,
+                            PENDING_QUEUE *p_pending_request_list);
+/* Remove the given request from the pending request queue            */
+void finish_pending_request(REQUEST *p_current_request,
+                            PENDING_QUEUE *p_pending_request_list,
+                            int error_code);
+/* Put a request taken off the queue at the end of the finished list  */
+REQUEST *take_finished_request(PENDING_QUEUE *p_pending_request_list);
+/* Take the first finished request, or NULL if there is none          */
+int find_next_cylinder(PENDING_QUEUE *p_pending_request_list,
+                       int priority, int cylinder, int direction);
+/* Find the nearest cylinder with requests of a priority class in the */
+/* given direction                                                    */
+
+/* cache.c                                                            */
+BLOCK_CACHE *create_cache(int block_count);
+/* Create an empty block cache holding the given number of blocks     */
+CACHE_BLOCK *find_cached_block(BLOCK_CACHE *p_cache, int block_number);
+/* Return the cached copy of a block, or NULL if there is none        */
+void link_cached_block(CACHE_BLOCK **p_p_newest, CACHE_BLOCK **p_p_oldest,
+                       CACHE_BLOCK *p_block);
+/* Make a block the newest on a list of clean or dirty blocks         */
+void unlink_cached_block(CACHE_BLOCK **p_p_newest, CACHE_BLOCK **p_p_oldest,
+                         CACHE_BLOCK *p_block);
+/* Take a block off a list of clean or dirty blocks                   */
+void drop_cached_block(BLOCK_CACHE *p_cache, CACHE_BLOCK *p_block);
+/* Take a block out of the hash table so it is not found              */
+CACHE_BLOCK *take_cache_block(BLOCK_CACHE *p_cache, int block_number);
+/* Give a block a cache block of its own, evicting the least recent   */
+/* clean block if none is free, or return NULL if none can go         */
+void read_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                       REQUEST *p_request);
+/* Finish a read from the cache, hold it on a block being read, or    */
+/* queue it for the disk                                              */
+void write_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                        REQUEST *p_request);
+/* Take a write into the cache and queue its write back, or queue the */
+/* write itself for the disk                                          */
+void fill_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                       REQUEST *p_request, int error_code);
+/* Bring the cache up to date with a finished read or write sent to   */
+/* the disk                                                           */
+void load_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                       CACHE_BLOCK *p_block, unsigned long int *p_data,
+                       int error_code);
+/* Keep the data the disk now holds in a block and finish the reads   */
+/* waiting on it, or give the block back if the disk failed to move   */
+/* it                                                                 */
+void flush_cached_block(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                        CACHE_BLOCK *p_block, int error_code);
+/* Mark a written back block clean and finish any syncs it releases   */
+void sync_cache(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                REQUEST *p_request);
+/* Finish a sync now, or hold it until the writes before it are back  */
+void follow_stream(BLOCK_CACHE *p_cache, int block_number);
+/* Add a read to the stream it continues, or start a new stream       */
+int plan_read_ahead(BLOCK_CACHE *p_cache, int block_number);
+/* Claim cache blocks for reading ahead from the given block if a     */
+/* stream runs up to it, returning how many were claimed              */
+void fill_read_ahead(BLOCK_CACHE *p_cache, PENDING_QUEUE *p_queue,
+                     int block_number, unsigned long int *p_data,
+                     int error_code);
+/* Keep a block read ahead in the block claimed for it                */
+
+/* power.c                                                            */
+void end_idle_time(DEVICE *p_device);
+/* Learn from an idle time the device's newly queued work has ended   */
+long long break_even_time(DEVICE *p_device);
+/* Return how long the motor must stay stopped to save the energy a   */
+/* spin up costs                                                      */
+long long spin_down_time(DEVICE *p_device);
+/* Return the device clock when an idle motor is stopped              */
+void stop_motor(DEVICE *p_device);
+/* Stop the motor and count the time it was running                   */
+long long motor_energy(DEVICE *p_device);
+/* Return the energy the motor has used so far, in millijoules, from  */
+/* its running and spin up power                                      */
+
+/* trace.c                                                            */
+void start_trace();
+/* Open the trace file and write its header, if a trace was asked for */
+void trace_message(MESSAGE *p_message);
+/* Record a message taken from the submission ring                    */
+int device_command(int device_number, int operation_code, int argument_1,
+                   int argument_2, int argument_3,
+                   unsigned long int *p_data_address);
+/* Send a command to a disk device, recording it and its status when  */
+/* tracing                                                            */
+void write_trace_record(int kind, int device_number, int operation_code,
+                        long long value_1, long long value_2,
+                        long long value_3, int result);
+/* Add one record, stamped with the device clock                      */
+void close_trace();
+/* Write out what is left of the trace and close it                   */
+
+/* ring.c                                                             */
+MESSAGE_RING *create_ring(int entries);
+/* Create an empty ring with room for the given number of messages,   */
+/* rounded up to a power of two                                       */
+RING_SLOT *claim_ring_slot(MESSAGE_RING *p_ring);
+/* Claim the next free slot for a producer to fill, or return NULL if */
+/* the ring is full                                                   */
+void publish_ring_slot(RING_SLOT *p_slot);
+/* Hand a filled slot over to the ring's consumer                     */
+bool push_ring(MESSAGE_RING *p_ring, MESSAGE *p_message);
+/* Add a copy of a message to a ring, returning false if it is full   */
+MESSAGE *peek_ring(MESSAGE_RING *p_ring);
+/* Return the oldest published message without taking it, or NULL if  */
+/* there is none yet                                                  */
+void pop_ring(MESSAGE_RING *p_ring);
+/* Take the oldest message, found with peek_ring, off the ring        */
+
+/* stats.c                                                            */
+void start_statistics();
+/* Catch the signals that dump the statistics or stop the driver, and */
+/* dump them once more at exit                                        */
+void catch_signal(int signal_number);
+/* Note a signal for the driver loop to act on                        */
+bool poll_statistics();
+/* Dump the statistics if a signal asked for them, returning true     */
+/* once the driver has been asked to stop                             */
+void record_sample(long long *p_histogram, long long value);
+/* Count a value in its power of two histogram bucket                 */
+void record_request(STATISTICS *p_statistics, REQUEST *p_request);
+/* Count a request reported back to the file system                   */
+void dump_statistics();
+/* Write every device's counters and histograms out in a line per     */
+/* value                                                              */
+
+/* schedule.c                                                         */
+int find_policy(char *p_name);
+/* Return the policy with the given name, or -1 if there is none      */
+int select_class(PENDING_QUEUE *p_pending_request_list,
+                 SCHEDULER *p_scheduler);
+/* Choose the priority class the elevator serves next                 */
+REQUEST *select_pending_request(PENDING_QUEUE *p_pending_request_list,
+                                SCHEDULER *p_scheduler, int disk_heads);
+/* Choose the next request to process with the scheduling policy      */
+
+#endif
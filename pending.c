@@ -0,0 +1,586 @@
+/**********************************************************************/
+/*                                                                    */
+/* Module Name:  pending - Cylinder indexed pending request queue     */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This module keeps the pending requests of each priority class in   */
+/* one doubly linked list per cylinder, sorted by block number, plus  */
+/* a bitmap of the cylinders that hold requests.  Adding a request    */
+/* only walks its own cylinder, removing a request unlinks it         */
+/* directly, and the elevator finds the next busy cylinder from the   */
+/* bitmap a word at a time instead of walking every request in the    */
+/* queue.  A second list keeps each class's requests in arrival order */
+/* so the oldest one is always at hand for the anti-starvation        */
+/* policy, and a third keeps every request with a deadline in         */
+/* deadline order.  Requests the device is done with wait on a        */
+/* finished list until they are reported back.                        */
+/*                                                                    */
+/* A hash table indexes the newest queued request for each block, and */
+/* each queued request links to the older and newer ones for its      */
+/* block, so the scheduler can always send a block's oldest request   */
+/* first and requests for one block reach the disk in arrival order   */
+/* whatever their classes and deadlines.  A read of a block with a    */
+/* read queued shares one disk read with it, the more pressing of the */
+/* two staying on the queue.  A read of a block with a write queued   */
+/* is given the write's data at once, and a write of a block with a   */
+/* write queued takes the older write's place, the older write being  */
+/* finished as if done.  Only requests still on the queue are         */
+/* indexed, so nothing is ever merged with a transfer the device has  */
+/* started.                                                           */
+/*                                                                    */
+/* Request nodes come from a fixed pool allocated with the queue at   */
+/* startup and kept on a free list, so the steady state never calls   */
+/* the heap.  When the pool runs dry the caller gets NULL back and    */
+/* leaves the request in the submission ring instead of aborting.     */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "driver.h"
+
+/**********************************************************************/
+/*     Create an empty pending request queue and its request pool     */
+/**********************************************************************/
+PENDING_QUEUE *create_list(int pool_size, int cylinders)
+{
+    PENDING_QUEUE *p_new_list; /* Points to the new pending queue     */
+    CLASS_QUEUE *p_class;      /* Points to a priority class's queue  */
+    int bucket_count = 1,      /* Block index buckets, a power of two */
+        count_request,         /* Count the request nodes             */
+        map_words,             /* Words in the cylinder bitmap        */
+        priority;              /* Count the priority classes          */
+
+    map_words = (cylinders + BITS_PER_MAP_WORD - 1) / BITS_PER_MAP_WORD;
+    while (bucket_count < pool_size)
+        bucket_count *= 2;
+    p_new_list = (PENDING_QUEUE *)calloc(1, sizeof(PENDING_QUEUE) +
+                                         pool_size * sizeof(REQUEST));
+    if (p_new_list != NULL)
+        p_new_list->p_block_hash =
+            (REQUEST **)calloc(bucket_count, sizeof(REQUEST *));
+    for (priority = 0; p_new_list != NULL &&
+                       p_new_list->p_block_hash != NULL &&
+                       priority < PRIORITY_CLASSES;
+         priority++)
+    {
+        p_class = &p_new_list->class_queue[priority];
+        if ((p_class->p_first_request =
+                 (REQUEST **)calloc(cylinders, sizeof(REQUEST *))) == NULL ||
+            (p_class->p_last_request =
+                 (REQUEST **)calloc(cylinders, sizeof(REQUEST *))) == NULL ||
+            (p_class->p_cylinder_map = (unsigned long long *)
+                 calloc(map_words, sizeof(unsigned long long))) == NULL)
+            break;
+    }
+    if (p_new_list == NULL || p_new_list->p_block_hash == NULL ||
+        priority < PRIORITY_CLASSES)
+    {
+        printf("\nError #%d occurred in create_list.", QUEUE_ALLOC_ERR);
+        printf("\nUnable to allocate memory for the pending queue.");
+        printf("\nThe program is aborting.");
+        exit(QUEUE_ALLOC_ERR);
+    }
+
+    /* Chain every request node onto the free list                    */
+    p_new_list->cylinders = cylinders;
+    p_new_list->map_words = map_words;
+    p_new_list->hash_mask = bucket_count - 1;
+    p_new_list->pool_size = pool_size;
+    for (count_request = pool_size - 1; count_request >= 0; count_request--)
+    {
+        p_new_list->pool_request[count_request].p_next_request =
+            p_new_list->p_free_request;
+        p_new_list->p_free_request = &p_new_list->pool_request[count_request];
+    }
+
+    return p_new_list;
+}
+
+/**********************************************************************/
+/*   Take a request node from the pool, or NULL if the pool is empty  */
+/**********************************************************************/
+REQUEST *create_pending_request(PENDING_QUEUE *p_pending_request_list,
+                                MESSAGE fs_message)
+{
+    REQUEST *p_new_request; /* Points to the new request              */
+
+    if ((p_new_request = p_pending_request_list->p_free_request) == NULL)
+    {
+        p_pending_request_list->pool_exhaustions += 1;
+        return NULL;
+    }
+    p_pending_request_list->p_free_request = p_new_request->p_next_request;
+    p_pending_request_list->pool_in_use += 1;
+    if (p_pending_request_list->pool_in_use >
+        p_pending_request_list->pool_high_water)
+        p_pending_request_list->pool_high_water =
+            p_pending_request_list->pool_in_use;
+
+    p_new_request->block_number = fs_message.block_number;
+    p_new_request->block_size = fs_message.block_size;
+    p_new_request->operation_code = fs_message.operation_code;
+    p_new_request->p_data_address = fs_message.p_data_address;
+    p_new_request->request_number = fs_message.request_number;
+    p_new_request->device_number = fs_message.device_number;
+    p_new_request->priority = fs_message.priority;
+    p_new_request->p_next_request = NULL;
+    p_new_request->p_previous_request = NULL;
+    p_new_request->p_cache_block = NULL;
+    p_new_request->p_first_duplicate = NULL;
+    p_new_request->queue_time = disk_clock();
+    p_new_request->dispatch_time = -1;
+    p_new_request->deadline = -1;
+    if (fs_message.deadline_time > 0)
+        p_new_request->deadline = p_new_request->queue_time +
+                                  fs_message.deadline_time;
+
+    /* Queue a request of no known class with the ordinary requests   */
+    if (fs_message.priority < 0 || fs_message.priority >= PRIORITY_CLASSES)
+        p_new_request->priority = PRIORITY_NORMAL;
+
+    /* Invalid block numbers are failed without ever being queued     */
+    p_new_request->cylinder = 0;
+    if (fs_message.block_number >= 1 &&
+        fs_message.block_number <= disk_geometry.block_count)
+        p_new_request->cylinder =
+            p_block_address[fs_message.block_number - 1].cylinder;
+
+    return p_new_request;
+}
+
+/**********************************************************************/
+/*                 Return a request node to the pool                  */
+/**********************************************************************/
+void free_pending_request(REQUEST *p_request,
+                          PENDING_QUEUE *p_pending_request_list)
+{
+    p_request->p_next_request = p_pending_request_list->p_free_request;
+    p_pending_request_list->p_free_request = p_request;
+    p_pending_request_list->pool_in_use -= 1;
+
+    return;
+}
+
+/**********************************************************************/
+/*  Add a new pending request to its class's cylinder in order by     */
+/*                          block number                              */
+/**********************************************************************/
+void add_pending_request(PENDING_QUEUE *p_pending_request_list,
+                         REQUEST *p_new_request)
+{
+    CLASS_QUEUE *p_class = &p_pending_request_list->class_queue[
+                               p_new_request->priority];
+                         /* Points to the request's class queue       */
+    REQUEST *p_previous, /* Points to the request to insert after     */
+        *p_next,         /* Points to the request to insert before    */
+        **p_p_link;      /* Points to the link to the block's index   */
+                         /* entry                                     */
+    int cylinder = p_new_request->cylinder; /* The request's cylinder */
+
+    /* Walk back from the highest block in the cylinder, so ascending */
+    /* streams insert without walking at all                          */
+    p_previous = p_class->p_last_request[cylinder];
+    while (p_previous != NULL &&
+           p_previous->block_number > p_new_request->block_number)
+        p_previous = p_previous->p_previous_request;
+
+    p_new_request->p_previous_request = p_previous;
+    if (p_previous == NULL)
+    {
+        p_new_request->p_next_request = p_class->p_first_request[cylinder];
+        p_class->p_first_request[cylinder] = p_new_request;
+    }
+    else
+    {
+        p_new_request->p_next_request = p_previous->p_next_request;
+        p_previous->p_next_request = p_new_request;
+    }
+
+    if (p_new_request->p_next_request == NULL)
+        p_class->p_last_request[cylinder] = p_new_request;
+    else
+        p_new_request->p_next_request->p_previous_request = p_new_request;
+
+    p_class->p_cylinder_map[cylinder / BITS_PER_MAP_WORD] |=
+        1ULL << (cylinder % BITS_PER_MAP_WORD);
+    p_class->request_count += 1;
+    p_pending_request_list->request_count += 1;
+
+    /* Append the request to its class's arrival order list           */
+    p_new_request->dispatch_stamp = p_pending_request_list->dispatch_count;
+    p_new_request->p_next_arrival = NULL;
+    p_new_request->p_previous_arrival = p_class->p_newest_request;
+    if (p_class->p_newest_request == NULL)
+        p_class->p_oldest_request = p_new_request;
+    else
+        p_class->p_newest_request->p_next_arrival = p_new_request;
+    p_class->p_newest_request = p_new_request;
+
+    /* Index the request as its block's newest, in place of any older */
+    /* request for the block, which it links to                       */
+    for (p_p_link = &p_pending_request_list->p_block_hash[
+             p_new_request->block_number & p_pending_request_list->hash_mask];
+         *p_p_link != NULL &&
+         (*p_p_link)->block_number != p_new_request->block_number;
+         p_p_link = &(*p_p_link)->p_next_hash)
+        ;
+    p_new_request->p_newer_block = NULL;
+    p_new_request->p_older_block = *p_p_link;
+    p_new_request->p_next_hash = NULL;
+    if (*p_p_link != NULL)
+    {
+        p_new_request->p_next_hash = (*p_p_link)->p_next_hash;
+        (*p_p_link)->p_newer_block = p_new_request;
+    }
+    *p_p_link = p_new_request;
+
+    /* Slot a request with a deadline in after every request due no   */
+    /* later than it, walking back from the latest deadline so the    */
+    /* usual request, due no sooner than the last, goes straight on   */
+    /* the end                                                        */
+    p_new_request->p_next_deadline = NULL;
+    p_new_request->p_previous_deadline = NULL;
+    if (p_new_request->deadline < 0)
+        return;
+    p_next = NULL;
+    p_previous = p_pending_request_list->p_last_deadline;
+    while (p_previous != NULL &&
+           p_previous->deadline > p_new_request->deadline)
+    {
+        p_next = p_previous;
+        p_previous = p_previous->p_previous_deadline;
+    }
+
+    p_new_request->p_previous_deadline = p_previous;
+    p_new_request->p_next_deadline = p_next;
+    if (p_previous == NULL)
+        p_pending_request_list->p_first_deadline = p_new_request;
+    else
+        p_previous->p_next_deadline = p_new_request;
+    if (p_next == NULL)
+        p_pending_request_list->p_last_deadline = p_new_request;
+    else
+        p_next->p_previous_deadline = p_new_request;
+
+    return;
+}
+
+/**********************************************************************/
+/*  Return the newest queued request for a block, or NULL if there is */
+/*                               none                                 */
+/**********************************************************************/
+REQUEST *find_queued_block(PENDING_QUEUE *p_pending_request_list,
+                           int block_number)
+{
+    REQUEST *p_request; /* Points to the request being checked        */
+
+    for (p_request = p_pending_request_list->p_block_hash[
+             block_number & p_pending_request_list->hash_mask];
+         p_request != NULL && p_request->block_number != block_number;
+         p_request = p_request->p_next_hash)
+        ;
+
+    return p_request;
+}
+
+/**********************************************************************/
+/*          Take a request out of the block index if it is there      */
+/**********************************************************************/
+void drop_queued_block(PENDING_QUEUE *p_pending_request_list,
+                       REQUEST *p_request)
+{
+    REQUEST **p_p_link; /* Points to the link to the request          */
+
+    /* A request with a newer one for its block is only linked from   */
+    /* the requests either side of it                                 */
+    if (p_request->p_newer_block != NULL)
+    {
+        p_request->p_newer_block->p_older_block = p_request->p_older_block;
+        if (p_request->p_older_block != NULL)
+            p_request->p_older_block->p_newer_block =
+                p_request->p_newer_block;
+        return;
+    }
+
+    /* The block's newest request hands its place in the index to the */
+    /* next older one, if there is one                                */
+    for (p_p_link = &p_pending_request_list->p_block_hash[
+             p_request->block_number & p_pending_request_list->hash_mask];
+         *p_p_link != NULL && *p_p_link != p_request;
+         p_p_link = &(*p_p_link)->p_next_hash)
+        ;
+    if (*p_p_link == NULL)
+        return;
+    if (p_request->p_older_block == NULL)
+        *p_p_link = p_request->p_next_hash;
+    else
+    {
+        p_request->p_older_block->p_newer_block = NULL;
+        p_request->p_older_block->p_next_hash = p_request->p_next_hash;
+        *p_p_link = p_request->p_older_block;
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*  Return the oldest queued request for the same block as a request  */
+/**********************************************************************/
+REQUEST *first_queued_block(REQUEST *p_request)
+{
+    while (p_request->p_older_block != NULL)
+        p_request = p_request->p_older_block;
+
+    return p_request;
+}
+
+/**********************************************************************/
+/*  Let a queued request for the same block serve a new request, or   */
+/*                 add the new request to the queue                   */
+/**********************************************************************/
+void merge_pending_request(PENDING_QUEUE *p_pending_request_list,
+                           REQUEST *p_new_request)
+{
+    REQUEST *p_queued = find_queued_block(p_pending_request_list,
+                                          p_new_request->block_number),
+                        /* Points to the block's newest queued        */
+                        /* request                                    */
+        **p_p_link;     /* Points to the link to the next duplicate   */
+
+    if (p_queued != NULL && p_queued->operation_code == 1 &&
+        p_new_request->operation_code == 1)
+    {
+        p_pending_request_list->merged_reads += 1;
+
+        /* A second read of the block waits on the first one's data,  */
+        /* unless it is more urgent or due sooner                     */
+        if (p_new_request->priority > p_queued->priority ||
+            (p_new_request->priority == p_queued->priority &&
+             (p_new_request->deadline < 0 ||
+              (p_queued->deadline >= 0 &&
+               p_queued->deadline <= p_new_request->deadline))))
+        {
+            for (p_p_link = &p_queued->p_first_duplicate; *p_p_link != NULL;
+                 p_p_link = &(*p_p_link)->p_next_request)
+                ;
+            p_new_request->p_next_request = NULL;
+            *p_p_link = p_new_request;
+            return;
+        }
+
+        /* The more pressing read takes the queued read's place, and  */
+        /* the queued read and the reads waiting on it wait on it     */
+        remove_pending_request(p_queued, p_pending_request_list);
+        add_pending_request(p_pending_request_list, p_new_request);
+        p_queued->p_next_request = p_queued->p_first_duplicate;
+        p_queued->p_first_duplicate = NULL;
+        p_new_request->p_first_duplicate = p_queued;
+        return;
+    }
+
+    if (p_queued != NULL && p_queued->operation_code == 2 &&
+        p_new_request->operation_code == 1)
+    {
+        /* A read of a block waiting to be written gets the data the  */
+        /* disk will hold once the write is done                      */
+        memcpy(p_new_request->p_data_address, p_queued->p_data_address,
+               disk_geometry.bytes_per_block);
+        finish_pending_request(p_new_request, p_pending_request_list, 0);
+        p_pending_request_list->forwarded_reads += 1;
+        return;
+    }
+
+    /* A write of a block waiting to be written makes the older write */
+    /* pointless, so it is finished without going to the disk         */
+    if (p_queued != NULL && p_queued->operation_code == 2)
+    {
+        remove_pending_request(p_queued, p_pending_request_list);
+        finish_pending_request(p_queued, p_pending_request_list, 0);
+        p_pending_request_list->superseded_writes += 1;
+    }
+    add_pending_request(p_pending_request_list, p_new_request);
+
+    return;
+}
+
+/**********************************************************************/
+/*      Remove the given request from the pending request queue       */
+/**********************************************************************/
+void remove_pending_request(REQUEST *p_current_request,
+                            PENDING_QUEUE *p_pending_request_list)
+{
+    CLASS_QUEUE *p_class = &p_pending_request_list->class_queue[
+                               p_current_request->priority];
+                                                /* Points to the      */
+                                                /* request's class    */
+                                                /* queue              */
+    int cylinder = p_current_request->cylinder; /* The request's      */
+                                                /* cylinder           */
+
+    if (p_current_request->p_previous_request == NULL)
+        p_class->p_first_request[cylinder] =
+            p_current_request->p_next_request;
+    else
+        p_current_request->p_previous_request->p_next_request =
+            p_current_request->p_next_request;
+
+    if (p_current_request->p_next_request == NULL)
+        p_class->p_last_request[cylinder] =
+            p_current_request->p_previous_request;
+    else
+        p_current_request->p_next_request->p_previous_request =
+            p_current_request->p_previous_request;
+
+    /* Clear the cylinder from the bitmap once its last request goes  */
+    if (p_class->p_first_request[cylinder] == NULL)
+        p_class->p_cylinder_map[cylinder / BITS_PER_MAP_WORD] &=
+            ~(1ULL << (cylinder % BITS_PER_MAP_WORD));
+    p_class->request_count -= 1;
+    p_pending_request_list->request_count -= 1;
+    drop_queued_block(p_pending_request_list, p_current_request);
+
+    if (p_current_request->p_previous_arrival == NULL)
+        p_class->p_oldest_request = p_current_request->p_next_arrival;
+    else
+        p_current_request->p_previous_arrival->p_next_arrival =
+            p_current_request->p_next_arrival;
+
+    if (p_current_request->p_next_arrival == NULL)
+        p_class->p_newest_request = p_current_request->p_previous_arrival;
+    else
+        p_current_request->p_next_arrival->p_previous_arrival =
+            p_current_request->p_previous_arrival;
+
+    /* Unlink a request with a deadline from the deadline order       */
+    if (p_current_request->deadline < 0)
+        return;
+    if (p_current_request->p_previous_deadline == NULL)
+        p_pending_request_list->p_first_deadline =
+            p_current_request->p_next_deadline;
+    else
+        p_current_request->p_previous_deadline->p_next_deadline =
+            p_current_request->p_next_deadline;
+    if (p_current_request->p_next_deadline == NULL)
+        p_pending_request_list->p_last_deadline =
+            p_current_request->p_previous_deadline;
+    else
+        p_current_request->p_next_deadline->p_previous_deadline =
+            p_current_request->p_previous_deadline;
+
+    return;
+}
+
+/**********************************************************************/
+/* Put a request taken off the queue at the end of the finished list  */
+/**********************************************************************/
+void finish_pending_request(REQUEST *p_current_request,
+                            PENDING_QUEUE *p_pending_request_list,
+                            int error_code)
+{
+    REQUEST *p_duplicate; /* Points to a read waiting on this one     */
+
+    p_current_request->error_code = error_code;
+    p_current_request->finish_time = disk_clock();
+    p_current_request->p_next_request = NULL;
+    if (p_pending_request_list->p_last_finished == NULL)
+        p_pending_request_list->p_first_finished = p_current_request;
+    else
+        p_pending_request_list->p_last_finished->p_next_request =
+            p_current_request;
+    p_pending_request_list->p_last_finished = p_current_request;
+    p_pending_request_list->finished_count += 1;
+
+    /* Reads that waited on this one finish with it, given its data   */
+    while ((p_duplicate = p_current_request->p_first_duplicate) != NULL)
+    {
+        p_current_request->p_first_duplicate = p_duplicate->p_next_request;
+        if (error_code == 0)
+            memcpy(p_duplicate->p_data_address,
+                   p_current_request->p_data_address,
+                   disk_geometry.bytes_per_block);
+        finish_pending_request(p_duplicate, p_pending_request_list,
+                               error_code);
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*     Take the first finished request, or NULL if there is none      */
+/**********************************************************************/
+REQUEST *take_finished_request(PENDING_QUEUE *p_pending_request_list)
+{
+    REQUEST *p_finished; /* Points to the first finished request      */
+
+    if ((p_finished = p_pending_request_list->p_first_finished) != NULL)
+    {
+        p_pending_request_list->p_first_finished = p_finished->p_next_request;
+        p_pending_request_list->finished_count -= 1;
+        if (p_pending_request_list->p_first_finished == NULL)
+            p_pending_request_list->p_last_finished = NULL;
+    }
+
+    return p_finished;
+}
+
+/**********************************************************************/
+/* Find the nearest cylinder with requests of a priority class in the */
+/*                         given direction                            */
+/**********************************************************************/
+int find_next_cylinder(PENDING_QUEUE *p_pending_request_list,
+                       int priority, int cylinder, int direction)
+{
+    unsigned long long *p_cylinder_map =
+        p_pending_request_list->class_queue[priority].p_cylinder_map;
+                             /* Points to the class's cylinder bitmap */
+    unsigned long long bits; /* Busy cylinders left in the word       */
+    int word;                /* Index of the bitmap word              */
+
+    if (direction > 0)
+    {
+        if (cylinder < 0)
+            cylinder = 0;
+        if (cylinder >= p_pending_request_list->cylinders)
+            return -1;
+
+        word = cylinder / BITS_PER_MAP_WORD;
+        bits = p_cylinder_map[word] &
+               (~0ULL << (cylinder % BITS_PER_MAP_WORD));
+        while (bits == 0)
+        {
+            if (++word >= p_pending_request_list->map_words)
+                return -1;
+            bits = p_cylinder_map[word];
+        }
+
+        return word * BITS_PER_MAP_WORD + __builtin_ctzll(bits);
+    }
+
+    if (cylinder >= p_pending_request_list->cylinders)
+        cylinder = p_pending_request_list->cylinders - 1;
+    if (cylinder < 0)
+        return -1;
+
+    word = cylinder / BITS_PER_MAP_WORD;
+    bits = p_cylinder_map[word] &
+           (~0ULL >> (BITS_PER_MAP_WORD - 1 - cylinder % BITS_PER_MAP_WORD));
+    while (bits == 0)
+    {
+        if (--word < 0)
+            return -1;
+        bits = p_cylinder_map[word];
+    }
+
+    return word * BITS_PER_MAP_WORD + BITS_PER_MAP_WORD - 1 -
+           __builtin_clzll(bits);
+}
@@ -0,0 +1,117 @@
+/**********************************************************************/
+/*                                                                    */
+/* Module Name:  power - Disk drive motor power management            */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This module decides when an idle device's motor is stopped.        */
+/* Stopping a motor saves its running power, but starting it again    */
+/* draws more power than running it and holds the next request back   */
+/* until the disk is up to speed.  A motor is worth stopping once it  */
+/* has been idle for the break even time, the time its running power  */
+/* takes to use up the energy of a spin up, worked out from how long  */
+/* the device's spin ups have really taken.  Waiting that long before */
+/* stopping never uses more than twice the energy of knowing each     */
+/* idle time ahead.                                                   */
+/*                                                                    */
+/* Each device also keeps a running average of its idle times, the    */
+/* newest counting half.  While that average is well over the break   */
+/* even time the next idle time is expected to be long as well, so    */
+/* the motor is stopped almost at once instead.  A stop followed by   */
+/* work sooner than the break even time is counted as early.          */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "driver.h"
+
+/**********************************************************************/
+/*   Learn from an idle time the device's newly queued work has ended */
+/**********************************************************************/
+void end_idle_time(DEVICE *p_device)
+{
+    long long idle_time = disk_clock() - p_device->idle_start;
+                         /* How long the device was idle              */
+
+    p_device->idle_average += (idle_time - p_device->idle_average) /
+                              IDLE_AVERAGE_WEIGHT;
+    if (!p_device->disk_on && p_device->statistics.motor_stops > 0 &&
+        idle_time < break_even_time(p_device))
+        p_device->statistics.early_spin_downs += 1;
+    p_device->idle_start = -1;
+
+    return;
+}
+
+/**********************************************************************/
+/*  Return how long the motor must stay stopped to save the energy a  */
+/*                        spin up costs                               */
+/**********************************************************************/
+long long break_even_time(DEVICE *p_device)
+{
+    long long spin_up_time = DEFAULT_SPIN_UP_TIME,
+                             /* How long a spin up takes              */
+        spin_ups = p_device->statistics.motor_starts;
+                             /* Spin ups that have reached speed      */
+
+    if (p_device->state == DEVICE_SPINNING_UP)
+        spin_ups -= 1;
+    if (spin_ups > 0)
+        spin_up_time = p_device->statistics.spin_up_time / spin_ups;
+
+    return spin_up_time * SPIN_UP_POWER / MOTOR_POWER;
+}
+
+/**********************************************************************/
+/*       Return the device clock when an idle motor is stopped        */
+/**********************************************************************/
+long long spin_down_time(DEVICE *p_device)
+{
+    long long break_even = break_even_time(p_device);
+                           /* Idle time that pays for a spin up       */
+
+    if (driver_options.spin_down_time > 0)
+        return p_device->idle_start + driver_options.spin_down_time;
+    if (p_device->idle_average > LONG_IDLE_FACTOR * break_even)
+        return p_device->idle_start + SHORT_SPIN_DOWN_TIME;
+
+    return p_device->idle_start + break_even;
+}
+
+/**********************************************************************/
+/*          Stop the motor and count the time it was running          */
+/**********************************************************************/
+void stop_motor(DEVICE *p_device)
+{
+    device_command(p_device->device_number, STOP_MOTOR, 0, 0, 0, 0);
+    p_device->disk_on = false;
+    p_device->statistics.motor_stops += 1;
+    p_device->statistics.motor_on_time +=
+        disk_clock() - p_device->spin_up_start;
+
+    return;
+}
+
+/**********************************************************************/
+/*  Return the energy the motor has used so far, in millijoules, from */
+/*                   its running and spin up power                    */
+/**********************************************************************/
+long long motor_energy(DEVICE *p_device)
+{
+    long long on_time = p_device->statistics.motor_on_time;
+                        /* Time the motor has been running            */
+
+    if (p_device->disk_on)
+        on_time += disk_clock() - p_device->spin_up_start;
+
+    return (on_time * MOTOR_POWER + p_device->statistics.spin_up_time *
+            (SPIN_UP_POWER - MOTOR_POWER)) / 1000000;
+}
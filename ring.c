@@ -0,0 +1,169 @@
+/**********************************************************************/
+/*                                                                    */
+/* Module Name:  ring - Lock-free message rings to the file system    */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This module keeps the rings the file system and the driver pass    */
+/* messages through, one ring of submitted requests and one of        */
+/* finished requests.  Any number of threads may add to a ring at     */
+/* once, and one thread takes from it, without a lock on either side. */
+/*                                                                    */
+/* Every slot carries a sequence number.  A slot is free for the      */
+/* producer claiming position n when its sequence is n, and holds a   */
+/* message for the consumer once its sequence is n + 1.  Producers    */
+/* claim positions by moving the tail on with compare and swap, fill  */
+/* the slot in, then publish it by storing its sequence.  The         */
+/* consumer reads the slot at the head once it is published, and      */
+/* hands it back for the producer one lap on by storing n plus the    */
+/* ring size.  A full ring turns the producer away rather than        */
+/* blocking it.  The tail and head sit in cache lines of their own so */
+/* producers and the consumer do not slow each other down.            */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "driver.h"
+
+/**********************************************************************/
+/*                          Global Variables                          */
+/**********************************************************************/
+MESSAGE_RING *p_submit_ring,   /* Requests from the file system       */
+    *p_complete_ring;          /* Finished requests to the file       */
+                               /* system                              */
+
+/**********************************************************************/
+/*  Create an empty ring with room for the given number of messages,  */
+/*                   rounded up to a power of two                     */
+/**********************************************************************/
+MESSAGE_RING *create_ring(int entries)
+{
+    MESSAGE_RING *p_new_ring; /* Points to the new ring               */
+    unsigned int size = 1,    /* Slots in the ring                    */
+        count_slot;           /* Count the slots                      */
+
+    while (size < (unsigned int)entries)
+        size *= 2;
+    if (posix_memalign((void **)&p_new_ring, CACHE_LINE_BYTES,
+                       sizeof(MESSAGE_RING) + size * sizeof(RING_SLOT))
+        != 0)
+    {
+        printf("\nError #%d occurred in create_ring.", RING_ALLOC_ERR);
+        printf("\nUnable to allocate memory for a message ring.");
+        printf("\nThe program is aborting.");
+        exit(RING_ALLOC_ERR);
+    }
+
+    memset(p_new_ring, 0, sizeof(MESSAGE_RING));
+    p_new_ring->mask = size - 1;
+    atomic_init(&p_new_ring->tail, 0);
+    p_new_ring->head = 0;
+    for (count_slot = 0; count_slot < size; count_slot++)
+        atomic_init(&p_new_ring->slot[count_slot].sequence, count_slot);
+
+    return p_new_ring;
+}
+
+/**********************************************************************/
+/*  Claim the next free slot for a producer to fill, or return NULL   */
+/*                        if the ring is full                         */
+/**********************************************************************/
+RING_SLOT *claim_ring_slot(MESSAGE_RING *p_ring)
+{
+    RING_SLOT *p_slot;      /* Points to the slot at the position     */
+    unsigned int position,  /* The position being claimed             */
+        sequence;           /* The slot's sequence number             */
+
+    position = atomic_load_explicit(&p_ring->tail, memory_order_relaxed);
+    while (true)
+    {
+        p_slot = &p_ring->slot[position & p_ring->mask];
+        sequence = atomic_load_explicit(&p_slot->sequence,
+                                        memory_order_acquire);
+
+        /* A free slot is claimed by whichever producer moves the     */
+        /* tail past it first, the others try the next position       */
+        if (sequence == position)
+        {
+            if (atomic_compare_exchange_weak_explicit(
+                    &p_ring->tail, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if ((int)(sequence - position) < 0)
+            return NULL;
+        else
+            position = atomic_load_explicit(&p_ring->tail,
+                                            memory_order_relaxed);
+    }
+    p_slot->position = position;
+
+    return p_slot;
+}
+
+/**********************************************************************/
+/*            Hand a filled slot over to the ring's consumer          */
+/**********************************************************************/
+void publish_ring_slot(RING_SLOT *p_slot)
+{
+    atomic_store_explicit(&p_slot->sequence, p_slot->position + 1,
+                          memory_order_release);
+
+    return;
+}
+
+/**********************************************************************/
+/*  Add a copy of a message to a ring, returning false if it is full  */
+/**********************************************************************/
+bool push_ring(MESSAGE_RING *p_ring, MESSAGE *p_message)
+{
+    RING_SLOT *p_slot; /* Points to the slot claimed                  */
+
+    if ((p_slot = claim_ring_slot(p_ring)) == NULL)
+        return false;
+    p_slot->message = *p_message;
+    publish_ring_slot(p_slot);
+
+    return true;
+}
+
+/**********************************************************************/
+/*   Return the oldest published message without taking it, or NULL   */
+/*                     if there is none yet                           */
+/**********************************************************************/
+MESSAGE *peek_ring(MESSAGE_RING *p_ring)
+{
+    RING_SLOT *p_slot = &p_ring->slot[p_ring->head & p_ring->mask];
+                       /* Points to the slot at the head              */
+
+    if (atomic_load_explicit(&p_slot->sequence, memory_order_acquire) !=
+        p_ring->head + 1)
+        return NULL;
+
+    return &p_slot->message;
+}
+
+/**********************************************************************/
+/*   Take the oldest message, found with peek_ring, off the ring      */
+/**********************************************************************/
+void pop_ring(MESSAGE_RING *p_ring)
+{
+    RING_SLOT *p_slot = &p_ring->slot[p_ring->head & p_ring->mask];
+                       /* Points to the slot at the head              */
+
+    atomic_store_explicit(&p_slot->sequence,
+                          p_ring->head + p_ring->mask + 1,
+                          memory_order_release);
+    p_ring->head += 1;
+
+    return;
+}
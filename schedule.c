@@ -0,0 +1,192 @@
+/**********************************************************************/
+/*                                                                    */
+/* Module Name:  schedule - Disk arm scheduling policies              */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This module chooses the next pending request for the disk arm.     */
+/* The policy is picked at startup, and the sweep direction is kept   */
+/* in the scheduler between requests so SCAN and LOOK really carry on */
+/* the way they were going.  SCAN and C-SCAN also hand back the edge  */
+/* cylinders the arm has to pass on the way to the chosen request.    */
+/*                                                                    */
+/* The elevator sweeps over the most urgent priority class with       */
+/* requests, so a burst of background writes cannot hold up the       */
+/* reads the file system waits on.  A lower class still gets a turn   */
+/* once its oldest request has been passed over for the DEADLINE      */
+/* expiry.  Ahead of any of that, the request with the earliest       */
+/* deadline is taken out of turn once it has less than a few average  */
+/* transfers' time left, so deadlines cost the sweep nothing until    */
+/* they are close.                                                    */
+/*                                                                    */
+/* Whichever way a request is chosen, the oldest queued request for   */
+/* its block goes in its place, so a more urgent request can never    */
+/* pass an older one for the same block and get or leave stale data.  */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "driver.h"
+
+/**********************************************************************/
+/*                          Global Variables                          */
+/**********************************************************************/
+char *p_policy_name[] = {"scan", "cscan", "look", "clook", "sstf",
+                         "deadline", NULL};
+                                /* Policy names, in policy order      */
+char *p_class_name[] = {"urgent", "normal", "background", NULL};
+                                /* Priority class names, most urgent  */
+                                /* first                              */
+
+/**********************************************************************/
+/*   Return the policy with the given name, or -1 if there is none    */
+/**********************************************************************/
+int find_policy(char *p_name)
+{
+    int policy; /* The policy being compared                          */
+
+    for (policy = 0; p_policy_name[policy] != NULL; policy++)
+        if (strcmp(p_policy_name[policy], p_name) == 0)
+            return policy;
+
+    return -1;
+}
+
+/**********************************************************************/
+/*    Choose the next request to process with the scheduling policy   */
+/**********************************************************************/
+REQUEST *select_pending_request(PENDING_QUEUE *p_pending_request_list,
+                                SCHEDULER *p_scheduler, int disk_heads)
+{
+    CLASS_QUEUE *p_class; /* Points to the class queue being served   */
+    REQUEST *p_oldest,   /* Points to the oldest pending request      */
+        *p_deadline;     /* Points to the request due soonest         */
+    int priority,        /* The priority class being served           */
+        cylinder,        /* The cylinder to process next              */
+        below,           /* Nearest busy cylinder below the heads     */
+        edge;            /* The edge cylinder in the sweep direction  */
+
+    p_scheduler->via_count = 0;
+    if (p_pending_request_list->request_count == 0)
+        return NULL;
+
+    /* Take the request due soonest out of turn once waiting for the  */
+    /* sweep could make it late, then sweep on from there             */
+    if ((p_deadline = p_pending_request_list->p_first_deadline) != NULL &&
+        p_deadline->deadline - disk_clock() <
+            DEADLINE_SLACK_TRANSFERS * p_scheduler->transfer_time)
+    {
+        if (p_deadline->cylinder != disk_heads)
+            p_scheduler->direction =
+                p_deadline->cylinder > disk_heads ? 1 : -1;
+        p_scheduler->deadline_dispatches += 1;
+        return first_queued_block(p_deadline);
+    }
+
+    priority = select_class(p_pending_request_list, p_scheduler);
+    p_class = &p_pending_request_list->class_queue[priority];
+
+    switch (p_scheduler->policy)
+    {
+    case SHORTEST_SEEK_FIRST:
+        /* Take whichever busy cylinder is closer, up on a tie        */
+        cylinder = find_next_cylinder(p_pending_request_list, priority,
+                                      disk_heads, 1);
+        below = find_next_cylinder(p_pending_request_list, priority,
+                                   disk_heads, -1);
+        if (cylinder < 0 ||
+            (below >= 0 && disk_heads - below < cylinder - disk_heads))
+            cylinder = below;
+        break;
+
+    case CIRCULAR_SCAN:
+    case CIRCULAR_LOOK:
+        /* Sweep up only, starting over from the bottom at the end    */
+        if ((cylinder = find_next_cylinder(p_pending_request_list,
+                                           priority, disk_heads, 1)) < 0)
+        {
+            cylinder = find_next_cylinder(p_pending_request_list,
+                                          priority, 0, 1);
+            if (p_scheduler->policy == CIRCULAR_SCAN)
+            {
+                if (disk_heads != p_pending_request_list->cylinders - 1)
+                    p_scheduler->via_cylinder[p_scheduler->via_count++] =
+                        p_pending_request_list->cylinders - 1;
+                if (cylinder != 0)
+                    p_scheduler->via_cylinder[p_scheduler->via_count++] = 0;
+            }
+        }
+        break;
+
+    case DEADLINE:
+        /* Serve the oldest request first once it has been passed     */
+        /* over too many times, then sweep on from there              */
+        p_oldest = p_class->p_oldest_request;
+        if (p_pending_request_list->dispatch_count - p_oldest->dispatch_stamp
+            >= p_scheduler->expire_dispatches)
+        {
+            if (p_oldest->cylinder != disk_heads)
+                p_scheduler->direction =
+                    p_oldest->cylinder > disk_heads ? 1 : -1;
+            return first_queued_block(p_oldest);
+        }
+        /* Otherwise sweep the same as LOOK                           */
+        /* Fall through                                               */
+
+    default:
+        /* Carry on in the current direction, reversing once there    */
+        /* is nothing left ahead of the heads                         */
+        if ((cylinder = find_next_cylinder(p_pending_request_list,
+                                           priority, disk_heads,
+                                           p_scheduler->direction)) < 0)
+        {
+            edge = p_scheduler->direction > 0 ?
+                       p_pending_request_list->cylinders - 1 : 0;
+            if (p_scheduler->policy == SCAN && disk_heads != edge)
+                p_scheduler->via_cylinder[p_scheduler->via_count++] = edge;
+
+            p_scheduler->direction = -p_scheduler->direction;
+            cylinder = find_next_cylinder(p_pending_request_list,
+                                          priority, disk_heads,
+                                          p_scheduler->direction);
+        }
+    }
+
+    return first_queued_block(p_class->p_first_request[cylinder]);
+}
+
+/**********************************************************************/
+/*        Choose the priority class the elevator serves next          */
+/**********************************************************************/
+int select_class(PENDING_QUEUE *p_pending_request_list,
+                 SCHEDULER *p_scheduler)
+{
+    REQUEST *p_oldest; /* Points to a class's oldest request          */
+    int priority,      /* Count the priority classes                  */
+        chosen = -1;   /* The most urgent class with requests         */
+
+    /* A lower class whose oldest request has waited out the expiry   */
+    /* goes ahead of the more urgent classes                          */
+    for (priority = 0; priority < PRIORITY_CLASSES; priority++)
+    {
+        if ((p_oldest = p_pending_request_list->class_queue[priority]
+                            .p_oldest_request) == NULL)
+            continue;
+        if (chosen < 0)
+            chosen = priority;
+        else if (p_pending_request_list->dispatch_count -
+                 p_oldest->dispatch_stamp >= p_scheduler->expire_dispatches)
+            return priority;
+    }
+
+    return chosen;
+}
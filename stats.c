@@ -0,0 +1,280 @@
+/**********************************************************************/
+/*                                                                    */
+/* Module Name:  stats - Driver counters and latency histograms       */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This module keeps what each device has done.  Every request is     */
+/* stamped when it is taken in, when its transfer starts, and when it */
+/* is finished, and is counted into fixed histograms as it is         */
+/* reported back, so the driver loop only adds to a few counters.     */
+/* Each histogram has a bucket per power of two: bucket 0 holds zero  */
+/* and bucket n the values from 2^(n-1) up to 2^n - 1.                */
+/*                                                                    */
+/* SIGUSR1 asks for the statistics, and SIGTERM or SIGINT asks the    */
+/* driver to stop.  The handlers only set a flag, the driver loop     */
+/* does the writing between rounds, and the statistics are written    */
+/* once more when the program exits.  Every value is a line of its    */
+/* own, either                                                        */
+/*                                                                    */
+/*   counter device name value                                        */
+/*   histogram device name low high count                             */
+/*                                                                    */
+/* between a "begin clock" and an "end" line.  Empty buckets are left */
+/* out, and the last bucket, which has no upper bound, shows -1.      */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include "driver.h"
+
+/**********************************************************************/
+/*                          Global Variables                          */
+/**********************************************************************/
+char *p_histogram_name[] = {"read_latency_us", "write_latency_us",
+                            "sync_latency_us", "queue_wait_us",
+                            "service_time_us", "seek_cylinders",
+                            "urgent_latency_us", "normal_latency_us",
+                            "background_latency_us", NULL};
+                                /* Histogram names, in histogram      */
+                                /* order                              */
+volatile sig_atomic_t dump_requested = 0, /* SIGUSR1 has arrived      */
+    stop_requested = 0;                   /* SIGTERM or SIGINT has    */
+                                          /* arrived                  */
+
+/**********************************************************************/
+/* Catch the signals that dump the statistics or stop the driver, and */
+/*                   dump them once more at exit                      */
+/**********************************************************************/
+void start_statistics()
+{
+    struct sigaction action; /* How the signals are handled           */
+
+    action.sa_handler = catch_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    atexit(dump_statistics);
+
+    return;
+}
+
+/**********************************************************************/
+/*           Note a signal for the driver loop to act on              */
+/**********************************************************************/
+void catch_signal(int signal_number)
+{
+    if (signal_number == SIGUSR1)
+        dump_requested = 1;
+    else
+        stop_requested = 1;
+
+    return;
+}
+
+/**********************************************************************/
+/*   Dump the statistics if a signal asked for them, returning true   */
+/*           once the driver has been asked to stop                   */
+/**********************************************************************/
+bool poll_statistics()
+{
+    if (dump_requested)
+    {
+        dump_requested = 0;
+        dump_statistics();
+    }
+
+    return stop_requested;
+}
+
+/**********************************************************************/
+/*        Count a value in its power of two histogram bucket          */
+/**********************************************************************/
+void record_sample(long long *p_histogram, long long value)
+{
+    int bucket = 0; /* The bucket holding the value                   */
+
+    if (value > 0)
+        bucket = 64 - __builtin_clzll((unsigned long long)value);
+    if (bucket >= HISTOGRAM_BUCKETS)
+        bucket = HISTOGRAM_BUCKETS - 1;
+    p_histogram[bucket] += 1;
+
+    return;
+}
+
+/**********************************************************************/
+/*         Count a request reported back to the file system           */
+/**********************************************************************/
+void record_request(STATISTICS *p_statistics, REQUEST *p_request)
+{
+    int latency; /* The request's latency histogram                   */
+
+    if (p_request->error_code != 0)
+    {
+        p_statistics->errors += 1;
+        return;
+    }
+
+    if (p_request->operation_code == 1)
+    {
+        p_statistics->reads += 1;
+        latency = READ_LATENCY;
+    }
+    else if (p_request->operation_code == 2)
+    {
+        p_statistics->writes += 1;
+        latency = WRITE_LATENCY;
+    }
+    else
+    {
+        p_statistics->syncs += 1;
+        latency = SYNC_LATENCY;
+    }
+    record_sample(p_statistics->histogram[latency],
+                  p_request->finish_time - p_request->queue_time);
+    record_sample(p_statistics->histogram[CLASS_LATENCY +
+                                          p_request->priority],
+                  p_request->finish_time - p_request->queue_time);
+    if (p_request->deadline >= 0 &&
+        p_request->finish_time > p_request->deadline)
+        p_statistics->deadline_misses[p_request->priority] += 1;
+
+    /* Split the time of requests the device moved into the wait for  */
+    /* the device and the device's own time                           */
+    if (p_request->dispatch_time >= 0)
+    {
+        record_sample(p_statistics->histogram[QUEUE_WAIT],
+                      p_request->dispatch_time - p_request->queue_time);
+        record_sample(p_statistics->histogram[SERVICE_TIME],
+                      p_request->finish_time - p_request->dispatch_time);
+    }
+
+    return;
+}
+
+/**********************************************************************/
+/*    Write every device's counters and histograms out in a line per  */
+/*                               value                                */
+/**********************************************************************/
+void dump_statistics()
+{
+    FILE *p_file = stderr;   /* The file the statistics go to         */
+    STATISTICS *p_statistics; /* Points to the device's statistics    */
+    PENDING_QUEUE *p_queue;  /* Points to the device's queue          */
+    BLOCK_CACHE *p_cache;    /* Points to the device's cache          */
+    int device_number,       /* Count the devices                     */
+        priority,            /* Count the priority classes            */
+        histogram,           /* Count the histograms                  */
+        bucket;              /* Count the histogram buckets           */
+
+    /* Fall back on standard error if the file cannot be opened       */
+    if (driver_options.p_stats_path != NULL &&
+        (p_file = fopen(driver_options.p_stats_path, "a")) == NULL)
+        p_file = stderr;
+
+    fprintf(p_file, "begin %lld\n", disk_clock());
+    for (device_number = 0; device_number < driver_options.devices;
+         device_number++)
+    {
+        p_statistics = &device[device_number].statistics;
+        fprintf(p_file, "counter %d reads %lld\n", device_number,
+                p_statistics->reads);
+        fprintf(p_file, "counter %d writes %lld\n", device_number,
+                p_statistics->writes);
+        fprintf(p_file, "counter %d syncs %lld\n", device_number,
+                p_statistics->syncs);
+        fprintf(p_file, "counter %d errors %lld\n", device_number,
+                p_statistics->errors);
+        fprintf(p_file, "counter %d transfers %lld\n", device_number,
+                p_statistics->transfers);
+        fprintf(p_file, "counter %d blocks_moved %lld\n", device_number,
+                p_statistics->blocks_moved);
+        fprintf(p_file, "counter %d seeks %lld\n", device_number,
+                p_statistics->seeks);
+        fprintf(p_file, "counter %d cylinders_traveled %lld\n",
+                device_number, p_statistics->cylinders_traveled);
+        fprintf(p_file, "counter %d recalibrations %lld\n", device_number,
+                p_statistics->recalibrations);
+        fprintf(p_file, "counter %d motor_starts %lld\n", device_number,
+                p_statistics->motor_starts);
+        fprintf(p_file, "counter %d motor_stops %lld\n", device_number,
+                p_statistics->motor_stops);
+        fprintf(p_file, "counter %d spin_up_us %lld\n", device_number,
+                p_statistics->spin_up_time);
+        fprintf(p_file, "counter %d early_spin_downs %lld\n", device_number,
+                p_statistics->early_spin_downs);
+        fprintf(p_file, "counter %d idle_average_us %lld\n", device_number,
+                device[device_number].idle_average);
+        fprintf(p_file, "counter %d break_even_us %lld\n", device_number,
+                break_even_time(&device[device_number]));
+        fprintf(p_file, "counter %d motor_energy_mj %lld\n", device_number,
+                motor_energy(&device[device_number]));
+        fprintf(p_file, "counter %d deadline_dispatches %lld\n",
+                device_number,
+                device[device_number].scheduler.deadline_dispatches);
+        for (priority = 0; priority < PRIORITY_CLASSES; priority++)
+            fprintf(p_file, "counter %d %s_deadline_misses %lld\n",
+                    device_number, p_class_name[priority],
+                    p_statistics->deadline_misses[priority]);
+
+        /* The queue and cache keep counters of their own             */
+        if ((p_queue = device[device_number].p_queue) != NULL)
+        {
+            fprintf(p_file, "counter %d pool_high_water %d\n",
+                    device_number, p_queue->pool_high_water);
+            fprintf(p_file, "counter %d pool_exhaustions %d\n",
+                    device_number, p_queue->pool_exhaustions);
+            fprintf(p_file, "counter %d merged_reads %lld\n",
+                    device_number, p_queue->merged_reads);
+            fprintf(p_file, "counter %d forwarded_reads %lld\n",
+                    device_number, p_queue->forwarded_reads);
+            fprintf(p_file, "counter %d superseded_writes %lld\n",
+                    device_number, p_queue->superseded_writes);
+        }
+        if ((p_cache = device[device_number].p_cache) != NULL)
+        {
+            fprintf(p_file, "counter %d cache_read_hits %lld\n",
+                    device_number, p_cache->read_hits);
+            fprintf(p_file, "counter %d cache_read_misses %lld\n",
+                    device_number, p_cache->read_misses);
+            fprintf(p_file, "counter %d cache_absorbed_writes %lld\n",
+                    device_number, p_cache->absorbed_writes);
+            fprintf(p_file, "counter %d cache_flushes %lld\n",
+                    device_number, p_cache->flushes);
+            fprintf(p_file, "counter %d read_ahead_hits %lld\n",
+                    device_number, p_cache->read_ahead_hits);
+            fprintf(p_file, "counter %d read_ahead_waste %lld\n",
+                    device_number, p_cache->read_ahead_waste);
+        }
+
+        for (histogram = 0; histogram < HISTOGRAMS; histogram++)
+            for (bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+                if (p_statistics->histogram[histogram][bucket] > 0)
+                    fprintf(p_file, "histogram %d %s %lld %lld %lld\n",
+                            device_number, p_histogram_name[histogram],
+                            bucket == 0 ? 0LL : 1LL << (bucket - 1),
+                            bucket == HISTOGRAM_BUCKETS - 1 ? -1LL :
+                                (1LL << bucket) - 1,
+                            p_statistics->histogram[histogram][bucket]);
+    }
+    fprintf(p_file, "end\n");
+
+    if (p_file == stderr)
+        fflush(p_file);
+    else
+        fclose(p_file);
+
+    return;
+}
@@ -0,0 +1,147 @@
+/**********************************************************************/
+/*                                                                    */
+/* Module Name:  trace - Binary trace of the driver's inputs          */
+/* Author:       Dave Safanyuk                                        */
+/* Installation: Pensacola Christian College, Pensacola, Florida      */
+/* Course:       CS326, Operating Systems                             */
+/*                                                                    */
+/**********************************************************************/
+
+/**********************************************************************/
+/*                                                                    */
+/* This module records what the driver sees into a trace file, so a   */
+/* run against a real disk can be replayed offline through the same   */
+/* scheduling code.  The file starts with a header giving the disk's  */
+/* geometry and the number of devices, followed by one fixed size     */
+/* record for every message taken from the submission ring and every  */
+/* command sent to a device, each stamped with the device clock.  The */
+/* records are written through a large buffer, so tracing only costs  */
+/* a copy per record between writes.                                  */
+/*                                                                    */
+/* Records keep the device clock as it was, and the header holds the  */
+/* clock when tracing started, so a replay can put every message at   */
+/* the same time from the start as it was taken in and the disk is    */
+/* found in the same place in its turn.                               */
+/*                                                                    */
+/* A message record holds the message's operation, device, block      */
+/* number, priority class, and deadline.  A command record holds the  */
+/* command, its device, its three arguments, and the status the       */
+/* device gave back.                                                  */
+/*                                                                    */
+/**********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "driver.h"
+
+/**********************************************************************/
+/*                          Global Variables                          */
+/**********************************************************************/
+FILE *p_trace_file = NULL;      /* The trace being written, or NULL   */
+
+/**********************************************************************/
+/*   Open the trace file and write its header, if a trace was asked   */
+/*                                 for                                */
+/**********************************************************************/
+void start_trace()
+{
+    TRACE_HEADER header; /* Describes the disks the trace is for      */
+
+    if (driver_options.p_trace_path == NULL)
+        return;
+    if ((p_trace_file = fopen(driver_options.p_trace_path, "wb")) == NULL)
+    {
+        printf("\nError #%d occurred in start_trace.", TRACE_ERR);
+        printf("\nUnable to open the trace file %s.",
+               driver_options.p_trace_path);
+        printf("\nThe program is aborting.");
+        exit(TRACE_ERR);
+    }
+    setvbuf(p_trace_file, NULL, _IOFBF, TRACE_BUFFER_BYTES);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.start_time = disk_clock();
+    header.record_bytes = sizeof(TRACE_RECORD);
+    header.devices = driver_options.devices;
+    header.cylinders = disk_geometry.cylinders;
+    header.tracks_per_cylinder = disk_geometry.tracks_per_cylinder;
+    header.sectors_per_track = disk_geometry.sectors_per_track;
+    header.sectors_per_block = disk_geometry.sectors_per_block;
+    fwrite(&header, sizeof(header), 1, p_trace_file);
+    atexit(close_trace);
+
+    return;
+}
+
+/**********************************************************************/
+/*          Record a message taken from the submission ring           */
+/**********************************************************************/
+void trace_message(MESSAGE *p_message)
+{
+    if (p_trace_file != NULL)
+        write_trace_record(TRACE_MESSAGE, p_message->device_number,
+                           p_message->operation_code,
+                           p_message->block_number, p_message->priority,
+                           p_message->deadline_time, 0);
+
+    return;
+}
+
+/**********************************************************************/
+/*  Send a command to a disk device, recording it and its status when */
+/*                            tracing                                 */
+/**********************************************************************/
+int device_command(int device_number, int operation_code, int argument_1,
+                   int argument_2, int argument_3,
+                   unsigned long int *p_data_address)
+{
+    int status = disk_drive(device_number, operation_code, argument_1,
+                            argument_2, argument_3, p_data_address);
+                 /* The status the device gave back                   */
+
+    if (p_trace_file != NULL)
+        write_trace_record(TRACE_COMMAND, device_number, operation_code,
+                           argument_1, argument_2, argument_3, status);
+
+    return status;
+}
+
+/**********************************************************************/
+/*          Add one record, stamped with the device clock             */
+/**********************************************************************/
+void write_trace_record(int kind, int device_number, int operation_code,
+                        long long value_1, long long value_2,
+                        long long value_3, int result)
+{
+    TRACE_RECORD record; /* The record being written                  */
+
+    record.time = disk_clock();
+    record.kind = kind;
+    record.device_number = device_number;
+    record.operation_code = operation_code;
+    record.value[0] = value_1;
+    record.value[1] = value_2;
+    record.value[2] = value_3;
+    record.result = result;
+    fwrite(&record, sizeof(record), 1, p_trace_file);
+
+    return;
+}
+
+/**********************************************************************/
+/*          Write out what is left of the trace and close it          */
+/**********************************************************************/
+void close_trace()
+{
+    if (p_trace_file != NULL)
+    {
+        fclose(p_trace_file);
+        p_trace_file = NULL;
+    }
+
+    return;
+}